@@ -0,0 +1,110 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "include/event.h"
+#include "include/eventQueue.h"
+
+// A calendar queue of events (R. Brown, 1988). Time is split into days of
+// equal width, and the days are spread over a year of buckets, like the
+// pages of a desk calendar: an event goes to the bucket of its day, modulo the
+// number of buckets. The earliest event is found by turning the pages from
+// the current day, so that updating a slot and finding the earliest event
+// both take O(1) on average.
+// The queue adapts to the simulation: the number of buckets follows the
+// number of events, and the width of a day follows the average time between
+// two consecutive earliest events.
+class CalendarQueue : public EventQueue {
+ public:
+  // Initializes an empty queue.
+  CalendarQueue();
+
+  // Stores the event in the specified slot, replacing the previous one.
+  void Update(int slot, const Event& event) override;
+
+  // Removes the event of the specified slot, if any.
+  void Remove(int slot) override;
+
+  // Returns whether the specified slot holds an event.
+  bool Contains(int slot) const override;
+
+  // Returns the event of the specified slot.
+  const Event& Get(int slot) const override;
+
+  // Returns the earliest event.
+  const Event& Top() const override;
+
+  // Returns the slot of the earliest event.
+  int TopSlot() const override;
+
+  // Returns whether the queue is empty.
+  bool Empty() const override;
+
+  // Returns the number of events in the queue.
+  std::size_t Size() const override;
+
+  // Removes every event.
+  void Clear() override;
+
+  // Replaces every event with the specified events, given with their slots.
+  void Assign(const std::vector<std::pair<int, Event>>& events) override;
+
+ private:
+  // An event, with its slot and its day.
+  struct Entry {
+    Event event;
+    int slot;
+    int64_t day;
+  };
+
+  // Returns the day of time t.
+  int64_t Day(double t) const;
+
+  // Returns the bucket of the specified day.
+  std::size_t Bucket(int64_t day) const;
+
+  // Adds the entry to the bucket of its day.
+  void Insert(const Entry& entry);
+
+  // Removes the entry of the specified slot from its bucket.
+  void Erase(int slot);
+
+  // Finds the earliest event, turning the pages from the current day.
+  void FindTop() const;
+
+  // Resizes the calendar when it holds too many or too few events per
+  // bucket, or when the width of a day no longer matches the event rate.
+  void Adapt();
+
+  // Spreads every event over the specified number of buckets, with a new
+  // day width.
+  void Rebuild(std::size_t buckets_count);
+
+  // Buckets of events, one per day of the year
+  std::vector<std::vector<Entry>> buckets_;
+
+  // Bucket and position in the bucket of the event of each slot, -1 if none
+  std::vector<int> bucket_of_, index_of_;
+
+  // Number of events in the queue
+  std::size_t size_;
+
+  // Width of a day
+  double width_;
+
+  // Current day: no event is older than it
+  mutable int64_t current_day_;
+
+  // Slot of the earliest event, -1 if it has to be looked for
+  mutable int top_slot_;
+
+  // Time of the last earliest event found, and sum and number of the times
+  // between consecutive earliest events since the last resize
+  mutable double last_top_time_, gaps_sum_;
+  mutable std::size_t gaps_count_;
+};
@@ -0,0 +1,101 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <vector>
+
+#include "include/serializer.h"
+
+// A uniform grid of square cells covering the whole window, used to find the
+// neighbours of a particle without looking at every other particle.
+// Cells are at least as wide as the largest particle diameter, so that a
+// particle can only collide with particles of the 9 cells around its own.
+// Since the grid covers the whole window, it stays valid whatever the size of
+// the simulation box.
+// Each cell holds a doubly linked list of particle indices. A grid may only
+// hold particles in some of its columns, e.g. for a strip of the window.
+class CellGrid {
+ public:
+  // Initializes an empty grid.
+  CellGrid();
+
+  // Splits the window into cells at least min_cell_size wide, 2048 at
+  // most along each axis, and empties them. Only the columns from
+  // first_column to last_column may hold particles: all of them by default.
+  void Reset(double min_cell_size, int particles_count, int first_column = 0,
+      int last_column = -1);
+
+  // Returns the index of the cell containing the point (rx, ry).
+  int Locate(double rx, double ry) const;
+
+  // Adds particle i to the specified cell.
+  void Insert(int i, int cell);
+
+  // Removes particle i from its cell.
+  void Remove(int i);
+
+  // Moves particle i from its cell to the specified cell.
+  void Move(int i, int cell);
+
+  // Returns the cell of particle i.
+  int GetCell(int i) const;
+
+  // Returns the first particle of the specified cell, -1 if empty.
+  int GetFirst(int cell) const;
+
+  // Returns the particle following particle i in its cell, -1 if last.
+  int GetNext(int i) const;
+
+  // Fills neighbours with the cells around the specified one (itself
+  // included) and returns their number. Only the columns which may hold
+  // particles are given.
+  int GetNeighbors(int cell, int neighbors[9]) const;
+
+  // Returns the amount of time for a particle in the specified cell, at
+  // position (rx, ry) with velocity (vx, vy), to cross the cell's boundary.
+  double TimeToLeaveCell(int cell, double rx, double ry,
+      double vx, double vy) const;
+
+  // Returns the cell a particle at position (rx, ry) with velocity (vx, vy)
+  // enters when it leaves the specified cell.
+  int GetNextCell(int cell, double rx, double ry, double vx, double vy) const;
+
+  // Returns the width of a cell.
+  double GetCellSize() const;
+
+  // Returns the number of cells along each axis.
+  int GetSize() const;
+
+  // Returns the column of the specified cell.
+  int GetColumn(int cell) const;
+
+  // Writes the cells and their lists of particles, for a checkpoint.
+  void Save(Serializer* out) const;
+
+  // Reads back the cells Save() wrote, and returns false if they are
+  // inconsistent.
+  bool Restore(Deserializer* in);
+
+ private:
+  // Returns the position of the specified cell in head_.
+  int Head(int cell) const;
+
+  // Returns the amount of time to cross the boundary of the cell along one
+  // axis, given the cell's column (or row) index.
+  double TimeToLeave(int index, double r, double v) const;
+
+  // Number of cells along each axis
+  int n_;
+
+  // Width of a cell
+  double cell_size_;
+
+  // Columns which may hold particles
+  int first_column_, last_column_;
+
+  // First particle of each cell
+  std::vector<int> head_;
+
+  // Linked lists of particles, and the cell of each particle
+  std::vector<int> next_, prev_, cell_;
+};
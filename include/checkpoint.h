@@ -0,0 +1,73 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Writes checkpoints to a file on a thread of its own: the simulation
+// thread only hands the state over, and never waits for the disk. Each
+// checkpoint replaces the previous one at once, so that the file always
+// holds a whole checkpoint.
+class CheckpointWriter {
+ public:
+  // Initializes a writer with no file.
+  CheckpointWriter();
+
+  // Writes the checkpoint left and stops the writer thread.
+  ~CheckpointWriter();
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  // Starts the writer thread, writing checkpoints to the specified file.
+  void Open(const std::string& path);
+
+  // Hands the specified state over to the writer thread, leaving state
+  // empty. A state not written yet is replaced, as it is out of date.
+  void Write(std::vector<char>* state);
+
+  // Writes the checkpoint left and stops the writer thread.
+  void Close();
+
+  // Returns the number of checkpoints written so far.
+  long GetCheckpoints() const;
+
+  // Returns whether a checkpoint could not be written.
+  bool HasFailed() const;
+
+ private:
+  // Writes the states handed over until the writer closes.
+  void Work();
+
+  // File written, and the temporary file written first
+  std::string path_, temporary_path_;
+
+  // Writer thread
+  std::thread thread_;
+
+  // Guards the members below
+  mutable std::mutex mutex_;
+
+  // Signals the writer thread that a state was handed over, or that the
+  // writer closes
+  std::condition_variable handed_;
+
+  // State to write, and whether there is one
+  std::vector<char> pending_;
+  bool has_pending_;
+
+  // Whether a checkpoint could not be written, and the number written
+  bool failed_;
+  long checkpoints_;
+
+  // Whether the writer thread runs, and whether it must stop
+  bool running_, closing_;
+};
+
+// Reads the state of the checkpoint in the specified file, and returns false
+// if the file is not a checkpoint this version reads.
+bool ReadCheckpoint(const std::string& path, std::vector<char>* state);
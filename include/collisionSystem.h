@@ -2,68 +2,238 @@
 
 #pragma once
 
+#include <cstddef>
+#include <memory>
+#include <utility>
 #include <vector>
-#include <queue>
-#include <functional>
-#include <string>
 
 #include "include/particle.h"
+#include "include/particleStore.h"
 #include "include/event.h"
-
+#include "include/eventQueue.h"
+#include "include/cellGrid.h"
+#include "include/overlaps.h"
+#include "include/pressureMeter.h"
+#include "include/serializer.h"
+#include "include/stats.h"
+#include "include/threadPool.h"
+
+// Event-driven simulation engine. Owns the particles, the event queue and the
+// simulation box, and never touches any graphics: front ends (the SFML viewer,
+// the batch mode) drive it through Step(), RunUntil() and RunEvents().
 class CollisionSystem {
  public:
-  // Initializes a system with the specified collection of particles.
-  explicit CollisionSystem(std::vector<Particle> particles, double friction);
+  // Initializes a system with the specified collection of particles, running
+  // on the specified scheduler, and predicting events on the specified
+  // number of threads, see SetThreads().
+  explicit CollisionSystem(std::vector<Particle> particles, double friction,
+      EventQueue::Type scheduler = EventQueue::Type::kHeap, int threads = 0);
 
   // Empty constructor: prevents a segmentation fault.
   ~CollisionSystem();
 
-  // Updates priority queue with all new events for particle a.
-  void Predict(Particle* a, double wall_size, double wall_speed);
+  // Returns the system a checkpoint saved, see Save(), running on the
+  // specified scheduler and predicting events on the specified number of
+  // threads. Returns nullptr if the checkpoint is inconsistent.
+  static std::unique_ptr<CollisionSystem> Restore(Deserializer* in,
+      EventQueue::Type scheduler = EventQueue::Type::kHeap, int threads = 0);
+
+  // Stores the earliest event of particle a in its slot of the event queue:
+  // collision with a particle of the neighbouring cells, or crossing into
+  // the next cell. A collision with particle b also replaces the event of b
+  // if it is earlier. Particles are given by index.
+  void Predict(int a);
+
+  // Stores the earliest collision of particle a with a wall in its wall slot
+  // of the event queue. Wall events are kept apart so that they can be
+  // predicted again on their own when the walls change speed.
+  void PredictWalls(int a);
+
+  // Empties the event queue, rebuilds the cell grid and predicts all
+  // future events.
+  void RegenerateEvents();
+
+  // Processes the next valid event and returns it. Redraw events are returned
+  // too, so that front ends know when to sample the system.
+  Event Step();
+
+  // Returns the time of the next valid event, the one Step() processes next.
+  double GetNextEventTime();
+
+  // Processes every event scheduled before time t, then moves every particle
+  // to time t.
+  void RunUntil(double t);
+
+  // Processes the next n valid events.
+  void RunEvents(long n);
+
+  // Adds a particle to the system, predicts its events and returns its
+  // index. The index of a particle never changes, and the events of the
+  // other particles remain valid.
+  int AddParticle(const Particle& particle);
+
+  // Removes particle i from the system, along with its events. Only the
+  // events of the other particles involving it are invalidated.
+  void RemoveParticle(int i);
+
+  // Returns the pairs of overlapping particles, each pair once with its
+  // smaller index first. O(N), using the cell grid.
+  std::vector<std::pair<int, int>> FindOverlaps();
+
+  // Resolves overlapping particles with the specified policy, and returns
+  // the number of overlapping pairs found. Only the events of the particles
+  // removed or moved are invalidated.
+  std::size_t ResolveOverlaps(OverlapPolicy policy);
+
+  // Moves every particle to the simulation clock time. Particles are only
+  // moved when they are involved in an event: call this before reading their
+  // positions. Redraw events and RunUntil() do it already.
+  void Synchronize();
+
+  // Returns the particles, as of their last update.
+  const ParticleStore& GetParticles() const;
+
+  // Returns the simulation clock time.
+  double GetTime() const;
+
+  // Returns the size of the simulation box.
+  double GetWallSize() const;
+
+  // Returns the speed of the walls.
+  double GetWallSpeed() const;
+
+  // Sets the speed of the walls and updates the wall events accordingly, in
+  // O(N).
+  void SetWallSpeed(double wall_speed);
+
+  // Returns the number of collisions processed so far.
+  long GetCollisions() const;
 
-  // Empties the priority queue and predicts all future events.
-  void RegenerateEvents(double wall_size, double wall_speed);
+  // Returns the average kinetic energy of the particles.
+  double GetAverageKineticEnergy() const;
 
-  // Redraws all particles.
-  void Redraw(bool isosurface);
+  // Returns the pressure (N/m) from the virial theorem: the kinetic energy
+  // of the particles, plus the momentum they exchanged in collisions over
+  // the pressure window. Holds for dense systems too, unlike the ideal gas
+  // law.
+  double GetPressure() const;
 
-  // Pauses the simulation.
-  void Pause(sf::Keyboard::Key pause_key);
+  // Returns the momentum the particles gave to the walls over the pressure
+  // window, per second and per meter of wall (N/m).
+  double GetWallPressure() const;
 
-  void DrawText(const sf::Font& font, const std::string& str,
-      int character_size, sf::Color color, int x, int y);
+  // Sets the window of simulation time the pressure is measured over, and
+  // starts measuring it again from now.
+  void SetPressureWindow(double window);
 
-  // Displays helper text.
-  void DisplayHelp(const sf::Font& font);
+  // Starts counting the speeds of the particles in a histogram of buckets of
+  // the specified size, see ParticleStore::GetSpeedHistogram().
+  void TrackSpeeds(double bucket_size);
 
-  // Displays physical quantities (temperature, pressure, etc.) and helper text.
-  void DisplayCharacteristics(const sf::Font& font, time_t elapsed_time,
-      int collisions, double average_kinetic_energy, double wall_size,
-      double wall_speed, sf::Time frameTime);
+  // Returns the number of events in the event queue.
+  std::size_t GetQueueSize() const;
+
+  // Returns the counters of the events processed so far, and of the time
+  // spent on them. Render time is left to front ends.
+  Stats GetStats() const;
 
-  // Display the velocity histogram.
-  void DisplayVelocityHistogram(double horizontal_scale,
-      double average_kinetic_energy);
+  // Writes the whole state of the system for a checkpoint: the particles as
+  // of their last update, the cells, the events of the queue and the
+  // counters, so that a system restored from it processes the same events to
+  // the last bit, and counts on from the same numbers.
+  void Save(Serializer* out) const;
 
-  // Simulates the system of particles for the specified amount of time.
-  int Simulate();
+  // Sets the number of threads predicting every event at once, when the
+  // system is built or its events regenerated: 0 (the default) for one per
+  // hardware thread, 1 to stay on the calling thread.
+  void SetThreads(int threads);
 
  private:
-  // The RenderWindow for the simulation
-  sf::RenderWindow window_;
+  // Initializes a system with no particles and no grid, to restore.
+  CollisionSystem(EventQueue::Type scheduler, int threads);
+
+  // Returns the slot of the events of particle i with other particles and
+  // cells in the event queue.
+  int Slot(int i) const;
+
+  // Returns the slot of the wall events of particle i in the event queue.
+  int WallSlot(int i) const;
+
+  // Fills candidates with the particles of the cells around particle a,
+  // which it may collide with.
+  void FindCandidates(int a, std::vector<int>* candidates) const;
+
+  // Returns the earliest event of particle a: collision with one of the
+  // candidates, or crossing into the next cell. Fills times with the
+  // collision times of the candidates. The particles must be synchronized.
+  Event EarliestEvent(int a, const std::vector<int>& candidates,
+      std::vector<double>* times) const;
+
+  // Returns the earliest collision of particle a with a wall. The particle
+  // must be synchronized.
+  Event EarliestWallEvent(int a) const;
+
+  // Predicts the events of every particle and replaces the events of the
+  // queue with them, along with a redraw event now. Large systems are split
+  // between the threads of the pool.
+  void PredictAll();
+
+  // Predicts the wall events of every particle.
+  void PredictWalls();
+
+  // Returns the earliest valid event, without removing it from the queue.
+  const Event& NextValidEvent();
+
+  // Moves the walls and the simulation clock to time t.
+  void Advance(double t);
+
+  // Moves particle i to the simulation clock time.
+  void Synchronize(int i);
+
+  // Ensures particle i stays inside the simulation box.
+  void Confine(int i);
+
+  // Sizes the cell grid for the largest particle and fills it.
+  void BuildGrid();
 
   // Number of redraw per clock tick
   double Hz_;
 
-  // Priority queue
-  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> pq_;
+  // Event queue, holding the earliest event of each particle
+  std::unique_ptr<EventQueue> queue_;
 
   // Simulation clock time
   double time_;
 
-  // Array of particles
-  std::vector<Particle> particles_;
+  // Particles
+  ParticleStore particles_;
+
+  // Cells of the particles, indexed like particles_
+  CellGrid grid_;
+
+  // Candidates for a collision with the particle being predicted, and their
+  // collision times: kept between predictions to avoid reallocations
+  std::vector<int> candidates_;
+  std::vector<double> times_;
 
   // Friction coefficient
   double friction_;
+
+  // Size and speed of the walls of the simulation box
+  double wall_size_, wall_speed_;
+
+  // Number of collisions processed so far
+  long collisions_;
+
+  // Momentum exchanged by the collisions over the pressure window
+  PressureMeter pressure_;
+
+  // Counters of the events processed so far, but for the overlaps, counted
+  // by the particles
+  Stats stats_;
+
+  // Number of threads predicting every event at once, 0 for one per
+  // hardware thread, and their pool, started when first needed
+  int threads_;
+  std::unique_ptr<ThreadPool> pool_;
 };
@@ -0,0 +1,12 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+// Kernels written with AVX2 intrinsics are built on x86-64 with GCC and
+// Clang, and only run if the CPU supports them, see HasAvx2().
+#if defined(__GNUC__) && defined(__x86_64__)
+#define MDSIM_AVX2
+#endif
+
+// Returns whether the CPU supports the AVX2 kernels.
+bool HasAvx2();
@@ -0,0 +1,258 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/event.h"
+#include "include/eventQueue.h"
+#include "include/cellGrid.h"
+
+// A change of a particle at the boundary between two neighbouring domains,
+// sent by one of them to the other.
+struct Message {
+  // Kinds of messages.
+  enum class Type : uint8_t {
+    // A particle of the first column of the sender changed its trajectory
+    // or its cell: sent to the domain on the left, which keeps a ghost of it
+    kGhost,
+    // A particle left the first column of the sender for its second column
+    kLeave,
+    // A particle of the receiver collided with a particle of the sender,
+    // the domain on its left
+    kImpose,
+    // A particle crossed into the strip of the receiver
+    kMigrate
+  };
+
+  Type type;
+
+  // Whether the message cancels a message sent earlier, which turned out to
+  // be wrong
+  bool cancel;
+
+  // Sending and receiving domains
+  int from, to;
+
+  // Particle, given by its index in the whole system, and its cell
+  int id, cell;
+
+  // Time of the change, and the particle: its trajectory, from the time of
+  // its last bounce
+  double time;
+  double radius, mass, birthdate;
+  ParticleStore::State state;
+};
+
+// A vertical strip of the simulation box, simulated on its own: its own
+// particles, its own event queue and its own clock (Time Warp, D. Jefferson,
+// 1985).
+// A domain owns the particles of its columns. It also keeps ghosts of the
+// particles of the first column of the domain on its right, the only ones
+// its particles may collide with, and decides of these collisions. Domains
+// only exchange messages about the particles at their boundaries.
+// A domain runs ahead of its neighbours, optimistically: when a message
+// from the past arrives, it rolls back to the time of the message, undoing
+// its changes since then, and sends again the messages which change.
+// Particles are only moved when they bounce: each one keeps the position of
+// its last change of trajectory, which every event time is computed from.
+// Running again after a rollback thus finds the same events to the last
+// bit, and only sends the messages the rollback actually changed.
+class Domain {
+ public:
+  // Initializes an empty domain, the index-th from the left, made of the
+  // specified columns of a grid of cells at least min_cell_size wide.
+  Domain(int index, int first_column, int last_column,
+      double min_cell_size, double friction, double wall_size,
+      EventQueue::Type scheduler);
+
+  // Adds the particle of the specified index in the whole system, either
+  // its own or the ghost of a particle of the next domain.
+  void Add(int id, const Particle& particle, bool ghost);
+
+  // Predicts the events of every particle, at the specified time.
+  void Start(double time);
+
+  // Takes the messages of the neighbouring domains into account, rolling
+  // back to the earliest of them if needed.
+  void Receive(const std::vector<Message>& messages);
+
+  // Processes at most count messages and events before time end, and
+  // returns how many it processed.
+  long Run(double end, long count);
+
+  // Returns the messages sent since the last call, and forgets them.
+  std::vector<Message> TakeMessages();
+
+  // Returns the time of the earliest message or event left to process.
+  double GetNextTime();
+
+  // Forgets how to roll back before time t: the domain never rolls back
+  // before the earliest time of all domains and messages.
+  void Commit(double t);
+
+  // Moves the particles of the domain to time t, and copies them into the
+  // specified store, at the index of each particle in the whole system.
+  // The totals of the store are left out of date, see
+  // ParticleStore::SumTotals(): domains collect at once.
+  void Collect(double t, ParticleStore* particles);
+
+  // Returns the number of collisions processed so far, the collisions with
+  // ghosts included.
+  long GetCollisions() const;
+
+  // Returns the number of messages and events processed so far, those
+  // undone included.
+  long GetEvents() const;
+
+  // Returns the number of messages and events undone so far.
+  long GetRollbacks() const;
+
+ private:
+  // A change of the domain, undone when rolling back.
+  struct Change {
+    // Kinds of changes.
+    enum class Type : uint8_t {
+      kState,         // Particle i changed, from state
+      kCell,          // Particle i moved, from cell
+      kAdd,           // Particle i was added
+      kRemove,        // Particle i was removed, from state and cell
+      kEvent,         // An event was processed
+      kMessage,       // A message was processed
+      kCollision      // A collision was processed
+    };
+
+    Type type;
+
+    // Time of the event or message which made the change
+    double time;
+
+    // Particle, its index in the whole system, and whether it is a ghost
+    int i, id;
+    bool ghost;
+
+    // Former cell and state of the particle, and its other properties
+    int cell;
+    ParticleStore::State state;
+    double radius, mass, birthdate;
+  };
+
+  // Returns the slot of the events of particle i with other particles and
+  // cells in the event queue.
+  int Slot(int i) const;
+
+  // Returns the slot of the wall events of particle i in the event queue.
+  int WallSlot(int i) const;
+
+  // Returns whether particle i is a particle of the first column, which
+  // the previous domain keeps a ghost of.
+  bool IsShared(int i) const;
+
+  // Stores the earliest event of particle a in its slot of the event queue:
+  // collision with a particle or a ghost of the neighbouring cells, or
+  // crossing into the next cell. A collision with particle b also replaces
+  // the event of b if it is earlier.
+  void Predict(int a);
+
+  // Stores the earliest collision of particle a with a wall in its wall
+  // slot of the event queue.
+  void PredictWalls(int a);
+
+  // Stores the collisions of ghost g with the particles of the domain in
+  // their slots of the event queue, when they are earlier.
+  void PredictGhost(int g);
+
+  // Returns the earliest valid event, nullptr if none.
+  const Event* NextValidEvent();
+
+  // Processes the specified event.
+  void Process(const Event& event);
+
+  // Processes the specified message.
+  void Process(const Message& message);
+
+  // Undoes every change made at time t or later.
+  void RollBack(double t);
+
+  // Sends a message to the neighbouring domain, unless the same message
+  // was sent before rolling back.
+  void Send(Message message);
+
+  // Returns a message of the specified type about particle i, as of now.
+  Message MakeMessage(Message::Type type, int to, int i) const;
+
+  // Adds a particle, with its cell, and returns its index.
+  int Add(int id, const Particle& particle, double time, int cell,
+      bool ghost);
+
+  // Removes particle i, along with its events.
+  void Remove(int i);
+
+  // Sets the state of particle i, remembering the former one.
+  void SetState(int i, const ParticleStore::State& state);
+
+  // Moves particle i to the specified cell, remembering the former one.
+  void Move(int i, int cell);
+
+  // Moves particle i to the domain clock time, keeping it inside the
+  // simulation box, before it bounces.
+  void Advance(int i);
+
+  // Remembers a change, to undo it when rolling back.
+  void Log(Change::Type type, int i);
+
+  // Position of the domain, from left to right
+  int index_;
+
+  // Columns of the domain
+  int first_column_, last_column_;
+
+  // Friction coefficient, and size of the simulation box
+  double friction_, wall_size_;
+
+  // Particles of the domain and ghosts, their indices in the whole system,
+  // and the other way round
+  ParticleStore particles_;
+  std::vector<int> ids_;
+  std::vector<uint8_t> ghosts_;
+  std::unordered_map<int, int> indices_;
+
+  // Cells of the particles and ghosts
+  CellGrid grid_;
+
+  // Event queue of the particles of the domain
+  std::unique_ptr<EventQueue> queue_;
+
+  // Time of the domain: every event and message before it was processed
+  double time_;
+
+  // Messages received, sorted by time, and the first one left to process
+  std::vector<Message> received_;
+  std::size_t next_message_;
+
+  // Changes since the last commit, to undo when rolling back
+  std::vector<Change> changes_;
+
+  // Messages sent since the last commit, and the messages sent before
+  // rolling back which were not sent again yet
+  std::vector<Message> sent_, unconfirmed_;
+
+  // Messages to send
+  std::vector<Message> outbox_;
+
+  // Particles changed by the changes undone, to predict again
+  std::vector<int> undone_;
+
+  // Number of collisions processed, of events and messages processed, and
+  // of events and messages undone
+  long collisions_, events_, rollbacks_;
+
+  // Whether changes are logged: not before the domain starts
+  bool logging_;
+};
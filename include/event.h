@@ -2,51 +2,64 @@
 
 #pragma once
 
-#include "include/particle.h"
+#include <cstdint>
+#include <vector>
 
 // A class describing an event: particle-particle collision, particle-wall
-// collision or redraw of each particle.
-// The collision system uses a priority queue to store all events.
+// collision, particle crossing into another cell of the grid or redraw of
+// each particle.
+// The collision system uses a priority queue to store all events. Particles
+// are referred to by their index in the system, so that events stay valid
+// when particles are added, and fit in 24 bytes.
 class Event {
  public:
-  enum class Type {
+  enum class Type : uint8_t {
     kParticleParticle,
     kVerticalWall,
     kHorizontalWall,
+    kCellCrossing,
     kRedraw
   };
 
+  // Index of the missing particles of an event.
+  static constexpr int kNone {-1};
+
   // Initializes a new event to occur at time t, involving particles a and b.
-  Event(Type type, double t, Particle* a = nullptr, Particle* b = nullptr);
+  // count_b is the collision count of particle b at event creation.
+  Event(Type type, double t, int a = kNone, int b = kNone, int count_b = 0);
 
   // > operator for the piority queue.
   bool operator>(const Event& rhs) const;
 
-  // Has any collision occurred between when event was created and now?
-  bool IsValid() const;
+  // Has particle b collided since the event was created? counts holds the
+  // collision count of each particle. Particle a is not checked: the engine
+  // replaces the event of a particle whenever it collides.
+  bool IsValid(const std::vector<int>& counts) const;
 
   // Returns the time that event is scheduled to occur.
   double GetTime() const;
 
-  // Returns particle A.
-  Particle* GetParticleA() const;
+  // Returns the index of particle A, kNone if none.
+  int GetParticleA() const;
 
-  // Returns particle B.
-  Particle* GetParticleB() const;
+  // Returns the index of particle B, kNone if none.
+  int GetParticleB() const;
 
   // Returns event type.
   Type GetType() const;
 
  private:
-  // Event type
-  Type type_;
-
   // Time that event is scheduled to occur
   double time_;
 
-  // Pointers to particles involved in event, possibly null
-  Particle *a_, *b_;
+  // Indices of particles involved in event, possibly kNone
+  int32_t a_, b_;
 
-  // Collision counts at event creation
-  int collisions_count_a_, collisions_count_b_;
+  // Collision count of particle b at event creation
+  int32_t count_b_;
+
+  // Event type
+  Type type_;
 };
+
+static_assert(sizeof(Event) <= 24, "Event should fit in 24 bytes");
@@ -0,0 +1,73 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "include/event.h"
+
+// A priority queue of events, addressed by slots. Each event is stored in a
+// slot (one per particle, plus one for the redraw event), and each slot holds
+// at most one event: updating a slot replaces its event. The queue thus never
+// holds more events than slots.
+// Events of equal times come in the order of their slots: the order of the
+// events only depends on the events and their slots, whatever the scheduler
+// and however the queue was filled.
+// This is the interface of the schedulers the engine can run on, see Create().
+class EventQueue {
+ public:
+  // Available schedulers.
+  enum class Type {
+    kHeap,
+    kCalendar
+  };
+
+  // Returns an empty queue of the specified type.
+  static std::unique_ptr<EventQueue> Create(Type type);
+
+  // Empty virtual destructor.
+  virtual ~EventQueue();
+
+  // Stores the event in the specified slot, replacing the previous one.
+  virtual void Update(int slot, const Event& event) = 0;
+
+  // Removes the event of the specified slot, if any.
+  virtual void Remove(int slot) = 0;
+
+  // Returns whether the specified slot holds an event.
+  virtual bool Contains(int slot) const = 0;
+
+  // Returns the event of the specified slot.
+  virtual const Event& Get(int slot) const = 0;
+
+  // Returns the earliest event.
+  virtual const Event& Top() const = 0;
+
+  // Returns the slot of the earliest event.
+  virtual int TopSlot() const = 0;
+
+  // Returns whether the queue is empty.
+  virtual bool Empty() const = 0;
+
+  // Returns the number of events in the queue.
+  virtual std::size_t Size() const = 0;
+
+  // Removes every event.
+  virtual void Clear() = 0;
+
+  // Replaces every event with the specified events, given with their slots.
+  // Each slot appears at most once. Faster than updating the slots one by
+  // one, e.g. to predict every event at once.
+  virtual void Assign(const std::vector<std::pair<int, Event>>& events);
+
+ protected:
+  // Returns whether event a, in slot slot_a, comes after event b, in slot
+  // slot_b. Defined here to be inlined in the schedulers.
+  static bool IsLater(const Event& a, int slot_a, const Event& b,
+      int slot_b) {
+    return a > b || (!(b > a) && slot_a > slot_b);
+  }
+};
@@ -0,0 +1,71 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "include/event.h"
+#include "include/eventQueue.h"
+
+// An indexed binary min-heap of events: updating a slot moves its event up
+// (decrease-key) or down the heap, in O(log n).
+class HeapQueue : public EventQueue {
+ public:
+  // Initializes an empty queue.
+  HeapQueue();
+
+  // Stores the event in the specified slot, replacing the previous one.
+  void Update(int slot, const Event& event) override;
+
+  // Removes the event of the specified slot, if any.
+  void Remove(int slot) override;
+
+  // Returns whether the specified slot holds an event.
+  bool Contains(int slot) const override;
+
+  // Returns the event of the specified slot.
+  const Event& Get(int slot) const override;
+
+  // Returns the earliest event.
+  const Event& Top() const override;
+
+  // Returns the slot of the earliest event.
+  int TopSlot() const override;
+
+  // Returns whether the queue is empty.
+  bool Empty() const override;
+
+  // Returns the number of events in the queue.
+  std::size_t Size() const override;
+
+  // Removes every event.
+  void Clear() override;
+
+  // Replaces every event with the specified events, given with their slots.
+  void Assign(const std::vector<std::pair<int, Event>>& events) override;
+
+ private:
+  // Moves the entry at heap position i up until the heap is ordered.
+  void SiftUp(std::size_t i);
+
+  // Moves the entry at heap position i down until the heap is ordered.
+  void SiftDown(std::size_t i);
+
+  // Returns whether the entry at heap position i comes after the entry at
+  // heap position j.
+  bool IsLater(std::size_t i, std::size_t j) const;
+
+  // Swaps the entries at heap positions i and j.
+  void Swap(std::size_t i, std::size_t j);
+
+  // Events, in heap order
+  std::vector<Event> events_;
+
+  // Slot of each event, in heap order
+  std::vector<int> slots_;
+
+  // Heap position of the event of each slot, -1 if none
+  std::vector<int> positions_;
+};
@@ -0,0 +1,78 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "include/snapshot.h"
+#include "include/threadPool.h"
+
+// Renders the density of the particles as an image: each particle adds a
+// kernel decreasing as the inverse of the distance to its center, cut off a
+// few radii away, and the sum is colored with a hue. Kernels are computed
+// once per radius and added around the pixel of each particle, so that a
+// particle only touches the pixels near it. Bands of rows are rendered in
+// parallel, eight pixels of a row at a time with AVX2, into buffers kept
+// from image to image.
+class IsosurfaceRenderer {
+ public:
+  // Initializes a renderer of images of width x height pixels, the top left
+  // one at (left, top) in the simulation box, rendered on the specified
+  // number of threads: 0 for one per hardware thread.
+  IsosurfaceRenderer(int width, int height, double left, double top,
+      int threads = 0);
+
+  IsosurfaceRenderer(const IsosurfaceRenderer&) = delete;
+  IsosurfaceRenderer& operator=(const IsosurfaceRenderer&) = delete;
+
+  // Renders the particles of the specified snapshot, and returns the
+  // pixels: width x height RGBA values, row by row.
+  const std::vector<uint8_t>& Render(const Snapshot& snapshot);
+
+  // Returns the width of the images, in pixels.
+  int GetWidth() const;
+
+  // Returns the height of the images, in pixels.
+  int GetHeight() const;
+
+ private:
+  // Values a particle of some radius adds to the pixels around its own: a
+  // square of 2 reach + 1 pixels a side, row by row.
+  struct Kernel {
+    double radius;
+    int reach;
+    std::vector<float> values;
+  };
+
+  // Returns the index of the kernel of particles of the specified radius,
+  // computed when first needed.
+  int FindKernel(double radius);
+
+  // Adds the specified kernel to the rows [begin, end) of the density,
+  // centered on the pixel of position (x, y) in the simulation box.
+  void Splat(const Kernel& kernel, double x, double y, int begin, int end);
+
+  // Size of the images, and position of their top left pixel
+  int width_, height_;
+  double left_, top_;
+
+  // Threads rendering bands of rows
+  std::unique_ptr<ThreadPool> pool_;
+
+  // Kernels of each radius met so far
+  std::vector<Kernel> kernels_;
+
+  // Particles sorted by their rows, their rows, and their kernels
+  std::vector<int> order_;
+  std::vector<double> rows_;
+  std::vector<int> kernel_of_;
+
+  // Density of each pixel, then its color
+  std::vector<float> density_;
+  std::vector<uint8_t> pixels_;
+
+  // Color of each whole hue, from 0 to the saturated one, as RGBA
+  std::vector<uint8_t> colors_;
+};
@@ -0,0 +1,19 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <vector>
+
+#include "include/particle.h"
+
+// Returns whether particles of the specified radius, the specified space
+// apart, make a square crystal: the radius is not negative, and the
+// particles are a positive distance apart from center to center.
+bool IsLatticeValid(double radius, double spacing);
+
+// Returns particles of the specified radius and unit mass filling the
+// simulation box in a simple square crystal, the specified space apart, with
+// random velocities drawn from the specified seed. The same seed gives the
+// same particles. Invalid crystals have no particles, see IsLatticeValid().
+std::vector<Particle> MakeSquareLattice(double radius, double spacing,
+    unsigned int seed);
@@ -0,0 +1,29 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/cellGrid.h"
+
+// How to resolve overlapping particles: remove the younger particle of each
+// pair (the oldest one if they have the same birthdate), or push both
+// particles apart.
+enum class OverlapPolicy {
+  kRemoveYounger,
+  kPushApart
+};
+
+// Returns the pairs of particles overlapping by more than EPSILON, each pair
+// once with its smaller index first. The grid must hold every particle, in
+// cells at least as wide as the largest particle diameter. O(N).
+std::vector<std::pair<int, int>> FindOverlaps(const ParticleStore& particles,
+    const CellGrid& grid);
+
+// Returns the pairs of overlapping particles of a collection, indexed like
+// the collection: used to validate initial configurations.
+std::vector<std::pair<int, int>> FindOverlaps(
+    const std::vector<Particle>& particles);
@@ -0,0 +1,125 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/eventQueue.h"
+#include "include/domain.h"
+#include "include/threadPool.h"
+
+// Event-driven simulation engine for large systems, splitting the simulation
+// box into vertical strips simulated in parallel, see Domain. Same physics
+// as CollisionSystem, with still walls.
+// Domains run in epochs: each thread processes the events of its domains
+// up to the end of a time window, in time order, and delivers their
+// messages to the neighbouring domains at once. Threads only run ahead of
+// each other by a few events. Once no domain has anything left to process
+// before the end of the window, every event before it is final. Event
+// times are computed so that results depend neither on the number of
+// domains, nor on the number of threads and their timing.
+class ParallelSystem {
+ public:
+  // Initializes a system with the specified collection of particles, split
+  // into the specified number of domains, each running on the specified
+  // scheduler. Domains are at least 2 cells wide: small systems get fewer
+  // domains.
+  ParallelSystem(std::vector<Particle> particles, double friction,
+      int domains, EventQueue::Type scheduler = EventQueue::Type::kHeap);
+
+  // Processes every event scheduled before time t, then moves every particle
+  // to time t.
+  void RunUntil(double t);
+
+  // Returns the particles, as of the last call to RunUntil(), indexed like
+  // the particles given.
+  const ParticleStore& GetParticles() const;
+
+  // Returns the simulation clock time.
+  double GetTime() const;
+
+  // Returns the size of the simulation box.
+  double GetWallSize() const;
+
+  // Returns the number of collisions processed so far.
+  long GetCollisions() const;
+
+  // Returns the average kinetic energy of the particles.
+  double GetAverageKineticEnergy() const;
+
+  // Returns the number of domains.
+  int GetDomains() const;
+
+  // Returns the number of events and messages undone so far, processed too
+  // early.
+  long GetRollbacks() const;
+
+  // Sets the number of threads running the domains: 0 (the default) for one
+  // per hardware thread, 1 to stay on the calling thread.
+  void SetThreads(int threads);
+
+ private:
+  // Runs every domain up to time end, and returns the earliest time of the
+  // events left.
+  double RunEpoch(double end);
+
+  // Runs the domains [begin, end) up to the end of the epoch, on the
+  // specified thread out of threads.
+  void RunDomains(std::size_t begin, std::size_t end, int thread,
+      int threads);
+
+  // Returns whether the specified thread, out of threads, whose domains
+  // have their earliest event or message at time t, runs too far ahead of
+  // the other threads.
+  bool IsAhead(int thread, int threads, double t) const;
+
+  // Delivers the specified messages to their domains.
+  void Deliver(const std::vector<Message>& messages);
+
+  // Waits for messages to the domains [begin, end), and returns false if
+  // the epoch ends first: every thread out of threads is waiting.
+  bool WaitForMessages(std::size_t begin, std::size_t end, int threads);
+
+  // Domains, from left to right
+  std::vector<std::unique_ptr<Domain>> domains_;
+
+  // Threads running the domains, and the time of the earliest event or
+  // message of the domains of each one, infinite while it waits
+  std::unique_ptr<ThreadPool> pool_;
+  std::vector<std::atomic<double>> frontiers_;
+
+  // Particles, as of the last call to RunUntil()
+  ParticleStore particles_;
+
+  // Simulation clock time: every event before it is final
+  double time_;
+
+  // End of the current epoch, and duration of the next one
+  double end_, window_;
+
+  // Size of the simulation box
+  double wall_size_;
+
+  // Guards the members below
+  std::mutex mutex_;
+
+  // Signals threads waiting for messages that messages arrived, or that
+  // the epoch ended
+  std::condition_variable delivered_;
+
+  // Messages each domain is to receive, and the number of deliveries so
+  // far, for threads to skip the inboxes when nothing was delivered
+  std::vector<std::vector<Message>> inboxes_;
+  std::atomic<long> deliveries_;
+
+  // Number of threads waiting for messages, and whether the epoch ended
+  int waiting_;
+  bool ended_;
+};
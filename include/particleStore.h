@@ -0,0 +1,230 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "include/particle.h"
+#include "include/serializer.h"
+#include "include/speedHistogram.h"
+
+// The particles of the simulation, stored as a structure of arrays: each
+// property of the particles is stored in its own array, indexed by particle.
+// Loops over one property, e.g. the positions, thus only read what they need.
+// Particles move in a straight line between collisions, and are only moved
+// when needed: each particle has its own time, see Update().
+// The index of a particle never changes: removing a particle frees its
+// index, which is given to the next particle added.
+// The totals of the store (kinetic energy, momentum, area, and the speed
+// histogram when asked for) are kept up to date as particles bounce, come
+// and go, so that reading them costs O(1).
+class ParticleStore {
+ public:
+  // What moving and colliding changes in a particle: its position and
+  // velocity, as of the time of its last update.
+  struct State {
+    double rx, ry;
+    double vx, vy;
+    double time;
+  };
+
+  // Initializes an empty store.
+  ParticleStore();
+
+  // Adds a particle, positioned as of its birthdate, and returns its index.
+  int Add(const Particle& particle);
+
+  // Removes particle i. Its index is free for a later particle.
+  void Remove(int i);
+
+  // Returns whether index i holds a particle.
+  bool IsAlive(int i) const;
+
+  // Returns the number of particles.
+  std::size_t Count() const;
+
+  // Removes every particle.
+  void Clear();
+
+  // Returns the number of indices: particle indices are all below it, but
+  // some of them may be free, see IsAlive().
+  std::size_t Size() const;
+
+  // Returns a copy of particle i, as of its last update.
+  Particle Get(int i) const;
+
+  // Moves particle i to time t, from the time of its last update.
+  void Update(int i, double t);
+
+  // Returns the state of particle i.
+  State GetState(int i) const;
+
+  // Sets the state of particle i, e.g. to undo its last collisions. Its
+  // events become invalid.
+  void SetState(int i, const State& state);
+
+  // Sets the state of particle i like SetState(), but leaves the totals out
+  // of date until SumTotals(): threads may set the states of distinct
+  // particles at once.
+  void SetStateOnly(int i, const State& state);
+
+  // Sums the totals again, from every particle.
+  void SumTotals();
+
+  // Returns the amount of time for particle i to collide with particle j,
+  // assuming no intervening collisions. Both particles must have been
+  // updated to the same time. Overlapping particles never collide: they are
+  // counted, see GetOverlaps().
+  double TimeToHit(int i, int j) const;
+
+  // Computes the amount of time for particle i to collide with each of the
+  // count candidates in times, and returns the position of the earliest
+  // collision in candidates, -1 if none. Uses AVX2 when the CPU supports it.
+  int TimeToHit(int i, const int* candidates, int count,
+      double* times) const;
+
+  // Returns the amount of time for particle i to collide with a vertical
+  // wall, assuming no intervening collisions.
+  double TimeToHitVerticalWall(int i, double wall_size,
+      double wall_speed) const;
+
+  // Returns the amount of time for particle i to collide with a horizontal
+  // wall, assuming no intervening collisions.
+  double TimeToHitHorizontalWall(int i, double wall_size,
+      double wall_speed) const;
+
+  // Returns by how much particles i and j overlap: the sum of their radii
+  // minus the distance between their centers. Negative if they do not
+  // overlap.
+  double Overlap(int i, int j) const;
+
+  // Moves particles i and j apart along the line of their centers, half way
+  // each, until they no longer overlap. Their events become invalid.
+  void PushApart(int i, int j);
+
+  // Updates the velocities of particles i and j according to the laws of
+  // elastic (or inelastic, with friction) collision, and returns the virial
+  // of the collision: the distance between their centers times the momentum
+  // they exchange.
+  double BounceOff(int i, int j, double friction);
+
+  // Updates the velocity of particle i upon collision with a vertical wall,
+  // and returns the momentum given to the wall.
+  double BounceOffVerticalWall(int i, double wall_speed);
+
+  // Updates the velocity of particle i upon collision with a horizontal wall,
+  // and returns the momentum given to the wall.
+  double BounceOffHorizontalWall(int i, double wall_speed);
+
+  // Returns the kinetic energy of particle i.
+  double KineticEnergy(int i) const;
+
+  // Returns the total kinetic energy of the particles, in joules.
+  double GetKineticEnergy() const;
+
+  // Returns the total momentum of the particles along x and y, in kg.m/s.
+  double GetMomentumX() const;
+  double GetMomentumY() const;
+
+  // Returns the area the particles cover, overlaps counted twice.
+  double GetArea() const;
+
+  // Starts counting the speeds of the particles in a histogram of buckets of
+  // the specified size, kept up to date from then on. O(N) once.
+  void TrackSpeeds(double bucket_size);
+
+  // Returns the histogram of the speeds of the particles, nullptr until
+  // TrackSpeeds() is called.
+  const SpeedHistogram* GetSpeedHistogram() const;
+
+  // Returns the speed of particle i.
+  double GetSpeed(int i) const;
+
+  // Returns the rx coordinate of particle i.
+  double GetRx(int i) const;
+
+  // Sets the rx coordinate of particle i.
+  void SetRx(int i, double rx);
+
+  // Returns the ry coordinate of particle i.
+  double GetRy(int i) const;
+
+  // Sets the ry coordinate of particle i.
+  void SetRy(int i, double ry);
+
+  // Returns the vx velocity of particle i.
+  double GetVx(int i) const;
+
+  // Returns the vy velocity of particle i.
+  double GetVy(int i) const;
+
+  // Returns the radius of particle i.
+  double GetRadius(int i) const;
+
+  // Returns the mass of particle i.
+  double GetMass(int i) const;
+
+  // Returns the time of the last update of particle i.
+  double GetTime(int i) const;
+
+  // Returns the birthdate of particle i.
+  double GetBirthdate(int i) const;
+
+  // Returns the number of collisions of each particle with either walls or
+  // other particles.
+  const std::vector<int>& GetCounts() const;
+
+  // Returns the number of overlapping pairs TimeToHit() met so far.
+  long GetOverlaps() const;
+
+  // Writes every particle and free index, and the overlaps met so far, for
+  // a checkpoint.
+  void Save(Serializer* out) const;
+
+  // Reads back the particles Save() wrote, and returns false if they are
+  // inconsistent.
+  bool Restore(Deserializer* in);
+
+ private:
+  // Adds the motion of particle i to the totals, or takes it away.
+  void AddMotion(int i);
+  void SubtractMotion(int i);
+
+  // Position
+  std::vector<double> rx_, ry_;
+
+  // Velocity
+  std::vector<double> vx_, vy_;
+
+  // Radius and mass
+  std::vector<double> radius_, mass_;
+
+  // Time of the last update of the position, and birthdate
+  std::vector<double> time_, birthdate_;
+
+  // Number of collisions so far
+  std::vector<int> count_;
+
+  // Whether each index holds a particle, and the free indices
+  std::vector<uint8_t> alive_;
+  std::vector<int> free_;
+
+  // Number of particles
+  std::size_t count_alive_;
+
+  // Totals of the particles: kinetic energy and momentum, in simulation
+  // units, and area
+  double kinetic_energy_;
+  double momentum_x_, momentum_y_;
+  double area_;
+
+  // Histogram of the speeds, only kept when asked for
+  std::unique_ptr<SpeedHistogram> speeds_;
+
+  // Number of overlapping pairs met, counted from every predicting thread
+  mutable std::atomic<long> overlaps_;
+};
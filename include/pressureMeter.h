@@ -0,0 +1,60 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <vector>
+
+// Sums the momentum the collisions transfer over a sliding window of
+// simulation time: the impulses given to the walls, and the virial of the
+// collisions between particles. The window is split into bins, dropped
+// whole as the clock moves on, so that each event costs O(1).
+class PressureMeter {
+ public:
+  // Initializes a meter summing over the specified window of simulation
+  // time, split into the specified number of bins, from time t on.
+  PressureMeter(double window, int bins, double t);
+
+  // Empties the meter, which now sums over the specified window from time t
+  // on.
+  void Reset(double window, double t);
+
+  // Moves the meter to time t, dropping the bins older than the window.
+  // Time never goes back.
+  void Advance(double t);
+
+  // Adds the momentum given to a wall.
+  void AddWallImpulse(double impulse);
+
+  // Adds the virial of a collision between particles: the distance between
+  // their centers times the momentum they exchange.
+  void AddVirial(double virial);
+
+  // Returns the momentum given to the walls over the window.
+  double GetWallImpulse() const;
+
+  // Returns the virial of the collisions over the window.
+  double GetVirial() const;
+
+  // Returns the simulation time the window covers so far: a little more
+  // than the window once full, as the current bin is only partly over.
+  double GetDuration() const;
+
+  // Returns the window of simulation time.
+  double GetWindow() const;
+
+ private:
+  // Width of the bins, and number of full bins in the window
+  double width_;
+  int bins_;
+
+  // Time of the start of the bins, and time of the meter
+  double start_, time_;
+
+  // Index of the current bin since start_
+  long bin_;
+
+  // Sums of each bin, a ring of bins_ full bins and the current one, and
+  // their totals
+  std::vector<double> wall_, virial_;
+  double wall_sum_, virial_sum_;
+};
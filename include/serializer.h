@@ -0,0 +1,87 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// Appends values to a buffer of bytes, as they are stored in memory: for
+// checkpoints, read back on the same kind of machine.
+class Serializer {
+ public:
+  // Initializes a serializer appending to the specified buffer.
+  explicit Serializer(std::vector<char>* buffer) : buffer_ {buffer} {}
+
+  // Appends a value.
+  template <typename T>
+  void Write(const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Only plain values are written as is");
+    const char* bytes {reinterpret_cast<const char*>(&value)};
+    buffer_->insert(buffer_->end(), bytes, bytes + sizeof(value));
+  }
+
+  // Appends the size of the values, then the values.
+  template <typename T>
+  void Write(const std::vector<T>& values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Only plain values are written as is");
+    Write(static_cast<uint64_t>(values.size()));
+    const char* bytes {reinterpret_cast<const char*>(values.data())};
+    buffer_->insert(buffer_->end(), bytes,
+        bytes + values.size() * sizeof(T));
+  }
+
+ private:
+  // Buffer appended to
+  std::vector<char>* buffer_;
+};
+
+// Reads back the values a Serializer wrote, in the same order.
+class Deserializer {
+ public:
+  // Initializes a deserializer reading the specified bytes.
+  Deserializer(const char* data, std::size_t size) :
+      data_ {data}, size_ {size}, position_ {0} {}
+
+  // Reads a value, and returns false if there are not enough bytes left.
+  template <typename T>
+  bool Read(T* value) {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Only plain values are read as is");
+    if (size_ - position_ < sizeof(*value)) {
+      return false;
+    }
+    std::memcpy(value, data_ + position_, sizeof(*value));
+    position_ += sizeof(*value);
+    return true;
+  }
+
+  // Reads values, and returns false if there are not enough bytes left.
+  template <typename T>
+  bool Read(std::vector<T>* values) {
+    static_assert(std::is_trivially_copyable<T>::value,
+        "Only plain values are read as is");
+    uint64_t size {0};
+    if (!Read(&size) || (size_ - position_) / sizeof(T) < size) {
+      return false;
+    }
+    values->resize(size);
+    std::memcpy(values->data(), data_ + position_, size * sizeof(T));
+    position_ += size * sizeof(T);
+    return true;
+  }
+
+  // Returns whether every byte was read.
+  bool IsDone() const {
+    return position_ == size_;
+  }
+
+ private:
+  // Bytes read, their number, and the position of the next one
+  const char* data_;
+  std::size_t size_, position_;
+};
@@ -0,0 +1,110 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/collisionSystem.h"
+#include "include/snapshot.h"
+
+// Runs a collision system on a thread of its own, so that a front end never
+// stalls it: at each redraw event, the thread publishes a snapshot of the
+// system, which the front end reads when it draws. Redraw events are paced
+// to a number per second of wall time, and the front end changes the system
+// by sending commands, run between two batches of events of a few
+// milliseconds.
+class SimulationThread {
+ public:
+  // A change of the system, run on the simulation thread.
+  typedef std::function<void(CollisionSystem* system)> Command;
+
+  // Starts a thread simulating the specified system, paused, with the
+  // specified number of redraw events per second. Particle tracked may be
+  // followed from collision to collision, see FollowPath(). The system must
+  // not be used elsewhere until the thread stops.
+  SimulationThread(CollisionSystem* system, double redraws_per_second,
+      int tracked);
+
+  // Stops the thread.
+  ~SimulationThread();
+
+  SimulationThread(const SimulationThread&) = delete;
+  SimulationThread& operator=(const SimulationThread&) = delete;
+
+  // Queues the specified command.
+  void Send(const Command& command);
+
+  // Pauses or resumes the simulation.
+  void SetPaused(bool paused);
+
+  // Starts or stops following the tracked particle. Following starts a new
+  // path, of its last few thousand positions.
+  void FollowPath(bool follow);
+
+  // Forgets the positions of the particle followed so far.
+  void ClearPath();
+
+  // Returns the latest snapshot published, which stays valid until the next
+  // call. Reads from a single thread only.
+  const Snapshot& GetLatest();
+
+  // Stops and joins the thread.
+  void Stop();
+
+ private:
+  // Simulates the system in batches of events until the thread stops.
+  void Work();
+
+  // Runs the commands queued, and returns false if the thread stops.
+  bool RunCommands();
+
+  // Adds the position of the tracked particle to its path, over the oldest
+  // one once the path is full.
+  void AddPathPoint();
+
+  // Takes a snapshot of the system and publishes it.
+  void Publish();
+
+  // Simulated system, and the particle followed
+  CollisionSystem* system_;
+  int tracked_;
+
+  // Wall time between two redraw events
+  std::chrono::steady_clock::duration redraw_period_;
+
+  // Whether the tracked particle is followed, and its positions: a ring
+  // buffer, starting at the oldest one once full
+  bool following_;
+  std::vector<double> path_x_, path_y_;
+  std::size_t path_start_;
+
+  // Snapshots published
+  SnapshotBuffer snapshots_;
+
+  // Simulation thread
+  std::thread thread_;
+
+  // Whether a command was queued, or the thread paused or stopped: checked
+  // between batches of events without taking the lock
+  std::atomic<bool> signaled_;
+
+  // Guards the members below
+  std::mutex mutex_;
+
+  // Signals the simulation thread that signaled_ was set
+  std::condition_variable changed_;
+
+  // Commands to run
+  std::deque<Command> commands_;
+
+  // Whether the simulation is paused, and whether the thread must stop
+  bool paused_, stopping_;
+};
@@ -0,0 +1,86 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "include/collisionSystem.h"
+#include "include/stats.h"
+
+// State of a collision system at some time, copied so that a front end reads
+// it while the system moves on: the particles alive, and the quantities
+// displayed.
+struct Snapshot {
+  // Initializes a snapshot of a system with no particles.
+  Snapshot();
+
+  // Copies the state of the specified system, as of the last update of its
+  // particles, reusing the memory of the arrays.
+  void Take(const CollisionSystem& system);
+
+  // Simulation clock time, size and speed of the walls
+  double time, wall_size, wall_speed;
+
+  // Positions, radii and speeds of the particles alive
+  std::vector<double> rx, ry, radius, speed;
+
+  // Area covered by the particles, and their average kinetic energy
+  double area, average_kinetic_energy;
+
+  // Pressure from the virial theorem, and on the walls (N/m)
+  double pressure, wall_pressure;
+
+  // Number of collisions processed, and of events in the queue
+  long collisions;
+  std::size_t queue_size;
+
+  // Counters of the engine
+  Stats stats;
+
+  // Size of the buckets of the speed histogram, and their counts: empty if
+  // the system does not track the speeds
+  double bucket_size;
+  std::vector<int> speed_counts;
+
+  // Positions of a particle followed from collision to collision, oldest
+  // first: empty unless it is followed
+  std::vector<double> path_x, path_y;
+};
+
+// Hands snapshots over from one writer thread to one reader thread without
+// locks: the writer fills a back buffer while the reader holds a front one,
+// and a third buffer in the middle swaps with either. The reader always gets
+// the latest snapshot published, and snapshots it missed are dropped.
+class SnapshotBuffer {
+ public:
+  // Initializes a buffer of empty snapshots.
+  SnapshotBuffer();
+
+  SnapshotBuffer(const SnapshotBuffer&) = delete;
+  SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+  // Returns the snapshot to fill, on the writer thread. It holds a snapshot
+  // published earlier, so that its arrays are reused.
+  Snapshot* GetBack();
+
+  // Publishes the snapshot filled, on the writer thread.
+  void Publish();
+
+  // Returns the latest snapshot published, on the reader thread. It stays
+  // valid until the next call.
+  const Snapshot& GetLatest();
+
+ private:
+  // Snapshots: back, middle and front
+  Snapshot snapshots_[3];
+
+  // Index of the back and front snapshots, owned by the writer and the
+  // reader
+  int back_, front_;
+
+  // Index of the middle snapshot, plus kFresh when it was published since
+  // the reader last took it
+  std::atomic<int> middle_;
+};
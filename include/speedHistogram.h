@@ -0,0 +1,45 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <vector>
+
+// Histogram of the speeds of the particles, in buckets of a fixed size,
+// updated one speed at a time: a bounce only moves its particles from one
+// bucket to another.
+class SpeedHistogram {
+ public:
+  // Initializes an empty histogram with buckets of the specified size.
+  explicit SpeedHistogram(double bucket_size);
+
+  // Counts a particle of the specified speed.
+  void Add(double speed);
+
+  // Stops counting a particle of the specified speed, as it was added.
+  void Remove(double speed);
+
+  // Removes every particle.
+  void Clear();
+
+  // Returns the size of the buckets.
+  double GetBucketSize() const;
+
+  // Returns the number of buckets up to the last one holding particles.
+  int GetBuckets() const;
+
+  // Returns the number of particles of bucket k.
+  int GetCount(int k) const;
+
+ private:
+  // Returns the bucket of the specified speed.
+  int GetBucket(double speed) const;
+
+  // Size of the buckets
+  double bucket_size_;
+
+  // Number of particles of each bucket, never shrunk
+  std::vector<int> counts_;
+
+  // Number of buckets up to the last one holding particles
+  int buckets_;
+};
@@ -0,0 +1,44 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+
+#include "include/event.h"
+
+// Number of event types, see Event::Type.
+static constexpr int kEventTypes {5};
+
+// Counters of the hot paths of the engine, cheap enough to always run: what
+// was processed, and where the wall time went.
+struct Stats {
+  // Initializes every counter to 0.
+  Stats();
+
+  // Returns the number of events processed of the specified type.
+  long GetEvents(Event::Type type) const;
+
+  // Returns the number of events processed, of every type.
+  long GetEvents() const;
+
+  // Events processed, indexed by Event::Type
+  long events[kEventTypes];
+
+  // Events popped from the queue after becoming invalid
+  long invalid_events;
+
+  // Largest number of events the queue held
+  std::size_t queue_high_water;
+
+  // Overlapping pairs of particles met when predicting collisions
+  long overlaps;
+
+  // Wall time spent predicting events, and moving the particles and
+  // bouncing them, in seconds: estimated from a sample of the events
+  double predict_seconds, advance_seconds;
+};
+
+// Writes the specified stats, at the specified simulation clock time, as
+// one line of JSON.
+void WriteStats(FILE* file, double time, const Stats& stats);
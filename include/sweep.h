@@ -0,0 +1,109 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/eventQueue.h"
+
+// A point of a parameter sweep: one headless run of a square crystal, see
+// MakeSquareLattice().
+struct SweepPoint {
+  double radius, spacing, friction;
+  unsigned int seed;
+};
+
+// Observables of one run of a sweep.
+struct SweepResult {
+  SweepPoint point;
+
+  // Number of particles, and fraction of the box they cover
+  std::size_t particles;
+  double packing_fraction;
+
+  // Duration of the run in simulation time, and collisions processed
+  double time;
+  long collisions;
+
+  // Collisions per particle per unit of simulation time
+  double collision_rate;
+
+  // Temperature at the end of the run (K), as the viewer shows it
+  double temperature;
+
+  // Momentum given to the walls per second and per meter of wall (N/m)
+  double pressure;
+
+  // Pressure from the virial theorem: kinetic energy and collisions between
+  // particles (N/m)
+  double virial_pressure;
+
+  // Wall-clock duration of the run (s)
+  double seconds;
+};
+
+// Parses a list of values: either comma separated values, or start:stop:step
+// for the values from start to stop included. Returns false if the list is
+// invalid.
+bool ParseValues(const std::string& list, std::vector<double>* values);
+
+// Returns every combination of the specified values, with seeds seeds from
+// first_seed on each.
+std::vector<SweepPoint> MakeSweep(const std::vector<double>& radii,
+    const std::vector<double>& spacings, const std::vector<double>& frictions,
+    unsigned int first_seed, int seeds);
+
+// Runs the specified point up to the specified time on the calling thread,
+// and returns its observables.
+SweepResult RunSweepPoint(const SweepPoint& point, double duration,
+    EventQueue::Type scheduler);
+
+// Writes the results of a sweep to a file as the runs complete, so that a
+// sweep cut short keeps the results of the runs done: one CSV line or JSON
+// object per run, or per set of parameters once all of its seeds are done if
+// average is true. Lines are written in the order the runs complete, and
+// flushed at once. Runs may complete on several threads.
+class SweepWriter {
+ public:
+  // Starts writing to the specified file, in JSON if json is true and in
+  // CSV otherwise, for a sweep of seeds runs per set of parameters, see
+  // MakeSweep().
+  SweepWriter(FILE* file, bool json, bool average, int seeds);
+
+  SweepWriter(const SweepWriter&) = delete;
+  SweepWriter& operator=(const SweepWriter&) = delete;
+
+  // Writes the result of run k of the sweep, or holds it until the other
+  // seeds of its parameters are done.
+  void Add(std::size_t k, const SweepResult& result);
+
+  // Ends the file, and returns false if it could not be written.
+  bool Close();
+
+ private:
+  // Writes a line of results: the name and value of each column.
+  void Write(const std::vector<std::pair<const char*, double>>& row);
+
+  // File written, its format, and whether runs are averaged
+  FILE* file_;
+  bool json_, average_;
+
+  // Runs per set of parameters
+  int seeds_;
+
+  // Guards the members below
+  std::mutex mutex_;
+
+  // Number of lines written
+  std::size_t rows_;
+
+  // Results held until every seed of their parameters is done, by set of
+  // parameters
+  std::map<std::size_t, std::vector<SweepResult>> pending_;
+};
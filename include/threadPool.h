@@ -0,0 +1,77 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads running loops in parallel. The calling
+// thread takes part in every loop, so a pool of 1 thread runs everything
+// serially and starts no thread at all.
+class ThreadPool {
+ public:
+  // A loop body: runs the iterations [begin, end) on the specified thread,
+  // numbered from 0 to GetThreads() - 1.
+  typedef std::function<void(std::size_t begin, std::size_t end,
+      int thread)> Task;
+
+  // Starts the specified number of threads, the calling one included. 0
+  // starts one per hardware thread.
+  explicit ThreadPool(int threads = 0);
+
+  // Stops and joins the worker threads.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Runs the iterations [0, count) of the task, split into one contiguous
+  // range per thread, and returns when they are all done.
+  void ParallelFor(std::size_t count, const Task& task);
+
+  // Runs the iterations [0, count) of the task one at a time, and returns
+  // when they are all done. Each thread starts with a contiguous range, and
+  // steals half of the iterations left to another thread once done with its
+  // own: suits iterations of uneven costs.
+  void ParallelForStealing(std::size_t count, const Task& task);
+
+  // Returns the number of threads, the calling one included.
+  int GetThreads() const;
+
+ private:
+  // Work of one thread for a loop.
+  typedef std::function<void(int thread)> Job;
+
+  // Runs the job on every thread, the calling one included, and returns
+  // when they are all done.
+  void Run(const Job& job);
+
+  // Waits for loops and runs the job of the specified worker thread.
+  void Work(int thread);
+
+  // Worker threads, numbered from 1
+  std::vector<std::thread> workers_;
+
+  // Guards every member below
+  std::mutex mutex_;
+
+  // Signals workers that a loop started or that the pool stops, and the
+  // calling thread that every worker is done
+  std::condition_variable start_, done_;
+
+  // Job of the current loop
+  const Job* job_;
+
+  // Number of loops started so far, so that workers run each loop once
+  long generation_;
+
+  // Number of workers still running the current loop
+  int running_;
+
+  // Whether the workers must stop
+  bool stop_;
+};
@@ -0,0 +1,189 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/particleStore.h"
+
+// Binary trajectory files: a header, then frames, then an index of the
+// frames. Everything is stored in the byte order of the writing machine and
+// aligned on 8 bytes, so that readers may map the file in memory and read
+// the arrays of any frame in place.
+// Each frame is a TrajectoryFrameHeader, followed by the indices of the
+// particles (int32_t, padded to 8 bytes), then by their rx, ry, vx and vy
+// (double), one array each.
+
+// Header at the start of a trajectory file.
+struct TrajectoryHeader {
+  // kTrajectoryMagic
+  char magic[8];
+
+  // kTrajectoryVersion, and kTrajectoryByteOrder as written
+  uint32_t version;
+  uint32_t byte_order;
+
+  // Size of the simulation box
+  double wall_size;
+
+  // Number of frames, and offset of their index: an array of the offsets of
+  // the frames (uint64_t). Both are 0 until the file is closed: readers then
+  // go from frame to frame.
+  uint64_t frames;
+  uint64_t index_offset;
+
+  uint64_t reserved[3];
+};
+
+// Header of a frame of a trajectory file.
+struct TrajectoryFrameHeader {
+  // Simulation clock time of the frame
+  double time;
+
+  // Number of particles, and size of the frame, its header included
+  uint64_t count;
+  uint64_t size;
+
+  uint64_t reserved;
+};
+
+static_assert(sizeof(TrajectoryHeader) == 64,
+    "TrajectoryHeader should take 64 bytes");
+static_assert(sizeof(TrajectoryFrameHeader) == 32,
+    "TrajectoryFrameHeader should take 32 bytes");
+
+// First bytes of a trajectory file.
+static constexpr char kTrajectoryMagic[8] {'M', 'D', 'T', 'R', 'A', 'J', 0, 0};
+
+// Version of the format, increased whenever it changes.
+static constexpr uint32_t kTrajectoryVersion {1};
+
+// Written as is: reads differently on a machine of the other byte order.
+static constexpr uint32_t kTrajectoryByteOrder {0x01020304};
+
+// Writes a trajectory file on a thread of its own: the simulation thread
+// only copies the particles of each frame, and never waits for the disk.
+class TrajectoryWriter {
+ public:
+  // Initializes a writer with no file.
+  TrajectoryWriter();
+
+  // Closes the file.
+  ~TrajectoryWriter();
+
+  TrajectoryWriter(const TrajectoryWriter&) = delete;
+  TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+  // Creates the specified file, for a simulation box of the specified size,
+  // and starts the writer thread. Returns false if the file cannot be
+  // created.
+  bool Open(const std::string& path, double wall_size);
+
+  // Queues a frame of the specified particles, as of their last update,
+  // at the specified time. The frame is dropped if the writer thread is too
+  // far behind.
+  void Write(double time, const ParticleStore& particles);
+
+  // Writes the frames left, then the index, and closes the file.
+  void Close();
+
+  // Returns the number of frames queued so far.
+  long GetFrames() const;
+
+  // Returns the number of frames dropped so far, the disk being too slow.
+  long GetDroppedFrames() const;
+
+  // Returns whether the file could not be written: it then holds the
+  // frames written before the failure, without an index.
+  bool HasFailed() const;
+
+ private:
+  // Writes the queued frames until the file is closed.
+  void Work();
+
+  // File, written by the writer thread only once opened
+  FILE* file_;
+
+  // Writer thread
+  std::thread thread_;
+
+  // Offsets of the frames written, and of the end of the file
+  std::vector<uint64_t> offsets_;
+  uint64_t offset_;
+
+  // Guards the members below
+  mutable std::mutex mutex_;
+
+  // Signals the writer thread that a frame is queued or that the file
+  // closes
+  std::condition_variable queued_;
+
+  // Frames to write, and buffers of frames written, to reuse
+  std::deque<std::vector<char>> pending_;
+  std::vector<std::vector<char>> buffers_;
+
+  // Numbers of frames queued and dropped
+  long frames_, dropped_;
+
+  // Whether a write failed
+  bool failed_;
+
+  // Whether the file closes
+  bool closing_;
+};
+
+// A trajectory file mapped in memory: frames are read in place.
+class TrajectoryReader {
+ public:
+  // A frame: arrays of count values each, pointing into the file.
+  struct Frame {
+    double time;
+    std::size_t count;
+    const int32_t* ids;
+    const double* rx;
+    const double* ry;
+    const double* vx;
+    const double* vy;
+  };
+
+  // Initializes a reader with no file.
+  TrajectoryReader();
+
+  // Unmaps the file.
+  ~TrajectoryReader();
+
+  TrajectoryReader(const TrajectoryReader&) = delete;
+  TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+
+  // Maps the specified file, and returns false if it is not a trajectory
+  // file this version reads, or if it is corrupt.
+  bool Open(const std::string& path);
+
+  // Unmaps the file.
+  void Close();
+
+  // Returns the size of the simulation box.
+  double GetWallSize() const;
+
+  // Returns the number of frames.
+  std::size_t GetFrames() const;
+
+  // Returns frame k.
+  Frame GetFrame(std::size_t k) const;
+
+ private:
+  // Mapped file, and its size
+  const char* data_;
+  std::size_t size_;
+
+  // Offsets of the frames
+  std::vector<uint64_t> offsets_;
+};
@@ -0,0 +1,84 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <SFML/Graphics.hpp>
+
+#include "include/collisionSystem.h"
+#include "include/isosurface.h"
+#include "include/simulationThread.h"
+#include "include/snapshot.h"
+
+// SFML front end: runs a CollisionSystem on a simulation thread, displays
+// the particles, the physical characteristics and the velocity histogram from
+// its snapshots, and handles user input.
+class Viewer {
+ public:
+  // Opens the window for the specified collision system.
+  explicit Viewer(CollisionSystem* system);
+
+  // Redraws all particles of the specified snapshot.
+  void Redraw(const Snapshot& snapshot, bool isosurface);
+
+  // Pauses the simulation until the specified key is released.
+  void Pause(sf::Keyboard::Key pause_key);
+
+  void DrawText(const sf::Font& font, const std::string& str,
+      int character_size, sf::Color color, int x, int y);
+
+  // Displays helper text.
+  void DisplayHelp(const sf::Font& font);
+
+  // Displays physical quantities (temperature, pressure, etc.) of the
+  // specified snapshot, the counters of the engine and helper text.
+  // elapsed_seconds is the wall time since the simulation started.
+  void DisplayCharacteristics(const Snapshot& snapshot, const sf::Font& font,
+      double elapsed_seconds, sf::Time frameTime);
+
+  // Display the velocity histogram of the specified snapshot.
+  void DisplayVelocityHistogram(const Snapshot& snapshot,
+      double horizontal_scale);
+
+  // Simulates the system of particles on a thread of its own until the
+  // window is closed.
+  int Run();
+
+ private:
+  // The RenderWindow for the simulation
+  sf::RenderWindow window_;
+
+  // The simulated system, and the thread simulating it while running
+  CollisionSystem* system_;
+  std::unique_ptr<SimulationThread> simulation_;
+
+  // Wall time spent drawing the frames so far, in seconds
+  double render_seconds_;
+
+  // Bars of the velocity histogram, its axis and the Maxwell-Boltzmann
+  // curve, as quads reused from frame to frame
+  sf::VertexArray histogram_;
+
+  // Points of the Maxwell-Boltzmann curve, and the temperature, number of
+  // buckets and scale they were computed for
+  std::vector<sf::Vector2f> maxwell_boltzmann_;
+  double curve_temperature_;
+  int curve_buckets_;
+  double curve_scale_;
+
+  // Renderer of the isosurfaces, started when first displayed, and the
+  // texture and sprite showing them
+  std::unique_ptr<IsosurfaceRenderer> isosurface_;
+  sf::Texture isosurface_texture_;
+  sf::Sprite isosurface_sprite_;
+
+  // Disks of the particles, as quads reused from frame to frame, and the
+  // texture drawn on them
+  sf::VertexArray disks_;
+  sf::Texture disk_texture_;
+
+  // Colors of the particles, by hue: looked up from their speed
+  std::vector<sf::Color> speed_colors_;
+};
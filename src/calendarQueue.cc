@@ -0,0 +1,283 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cmath>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "include/calendarQueue.h"
+#include "include/event.h"
+
+// Minimum number of buckets.
+static constexpr std::size_t kMinBuckets {2};
+
+// Width of a day, in average times between consecutive events.
+static constexpr double kDayWidth {3.0};
+
+// Latest day: later events, e.g. at infinity, all go to this day.
+static constexpr double kMaxDay {1e18};
+
+// Initializes an empty queue.
+CalendarQueue::CalendarQueue() :
+    buckets_(kMinBuckets),
+    size_ {0},
+    width_ {1.0},
+    current_day_ {0},
+    top_slot_ {-1},
+    last_top_time_ {0.0}, gaps_sum_ {0.0},
+    gaps_count_ {0} {}
+
+// Stores the event in the specified slot, replacing the previous one.
+void CalendarQueue::Update(int slot, const Event& event) {
+  if (slot >= static_cast<int>(bucket_of_.size())) {
+    bucket_of_.resize(slot + 1, -1);
+    index_of_.resize(slot + 1, -1);
+  }
+
+  // Keep the earliest event up to date when possible, instead of looking
+  // for it again
+  if (slot == top_slot_) {
+    if (event.GetTime() > Get(slot).GetTime()) {
+      top_slot_ = -1;
+    }
+  } else if (top_slot_ != -1 && IsLater(Get(top_slot_), top_slot_, event,
+      slot)) {
+    top_slot_ = slot;
+  }
+
+  Entry entry {event, slot, Day(event.GetTime())};
+  if (Contains(slot)) {
+    Entry& previous = buckets_[bucket_of_[slot]][index_of_[slot]];
+    if (previous.day == entry.day) {
+      previous = entry;
+      return;
+    }
+    Erase(slot);
+  }
+
+  if (size_ == 0 || entry.day < current_day_) {
+    current_day_ = entry.day;
+  }
+  Insert(entry);
+  Adapt();
+}
+
+// Removes the event of the specified slot, if any.
+void CalendarQueue::Remove(int slot) {
+  if (!Contains(slot)) {
+    return;
+  }
+
+  if (slot == top_slot_) {
+    top_slot_ = -1;
+  }
+  Erase(slot);
+  Adapt();
+}
+
+// Returns whether the specified slot holds an event.
+bool CalendarQueue::Contains(int slot) const {
+  return slot < static_cast<int>(bucket_of_.size()) && bucket_of_[slot] != -1;
+}
+
+// Returns the event of the specified slot.
+const Event& CalendarQueue::Get(int slot) const {
+  return buckets_[bucket_of_[slot]][index_of_[slot]].event;
+}
+
+// Returns the earliest event.
+const Event& CalendarQueue::Top() const {
+  return Get(TopSlot());
+}
+
+// Returns the slot of the earliest event.
+int CalendarQueue::TopSlot() const {
+  if (top_slot_ == -1) {
+    FindTop();
+  }
+  return top_slot_;
+}
+
+// Returns whether the queue is empty.
+bool CalendarQueue::Empty() const {
+  return size_ == 0;
+}
+
+// Returns the number of events in the queue.
+std::size_t CalendarQueue::Size() const {
+  return size_;
+}
+
+// Removes every event.
+void CalendarQueue::Clear() {
+  for (auto& bucket : buckets_) {
+    bucket.clear();
+  }
+  bucket_of_.assign(bucket_of_.size(), -1);
+  index_of_.assign(index_of_.size(), -1);
+  size_ = 0;
+  top_slot_ = -1;
+}
+
+// Replaces every event with the specified events, given with their slots.
+// The calendar is then sized for them at once.
+void CalendarQueue::Assign(
+    const std::vector<std::pair<int, Event>>& events) {
+  Clear();
+  for (const auto& event : events) {
+    if (event.first >= static_cast<int>(bucket_of_.size())) {
+      bucket_of_.resize(event.first + 1, -1);
+      index_of_.resize(event.first + 1, -1);
+    }
+    Insert(Entry {event.second, event.first, Day(event.second.GetTime())});
+  }
+
+  std::size_t buckets_count {kMinBuckets};
+  while (size_ > 2 * buckets_count) {
+    buckets_count *= 2;
+  }
+  Rebuild(buckets_count);
+}
+
+// Returns the day of time t.
+int64_t CalendarQueue::Day(double t) const {
+  double day {floor(t / width_)};
+  if (!(day < kMaxDay)) {
+    day = kMaxDay;
+  }
+  return static_cast<int64_t>(day);
+}
+
+// Returns the bucket of the specified day.
+std::size_t CalendarQueue::Bucket(int64_t day) const {
+  // The number of buckets is a power of 2
+  return static_cast<uint64_t>(day) & (buckets_.size() - 1);
+}
+
+// Adds the entry to the bucket of its day.
+void CalendarQueue::Insert(const Entry& entry) {
+  std::size_t bucket {Bucket(entry.day)};
+  bucket_of_[entry.slot] = bucket;
+  index_of_[entry.slot] = buckets_[bucket].size();
+  buckets_[bucket].push_back(entry);
+  ++size_;
+}
+
+// Removes the entry of the specified slot from its bucket.
+void CalendarQueue::Erase(int slot) {
+  std::vector<Entry>& bucket = buckets_[bucket_of_[slot]];
+  std::size_t i = index_of_[slot];
+  if (i != bucket.size() - 1) {
+    bucket[i] = bucket.back();
+    index_of_[bucket[i].slot] = i;
+  }
+  bucket.pop_back();
+  bucket_of_[slot] = -1;
+  index_of_[slot] = -1;
+  --size_;
+}
+
+// Finds the earliest event, turning the pages from the current day.
+void CalendarQueue::FindTop() const {
+  const Entry* top {nullptr};
+
+  // Over one year, the first day holding an event holds the earliest one
+  int64_t day {current_day_};
+  for (std::size_t k {0}; k < buckets_.size() && top == nullptr; ++k, ++day) {
+    for (const auto& entry : buckets_[Bucket(day)]) {
+      if (entry.day <= day && (top == nullptr
+          || IsLater(top->event, top->slot, entry.event, entry.slot))) {
+        top = &entry;
+      }
+    }
+  }
+
+  // Every event is more than a year away: direct search
+  if (top == nullptr) {
+    for (const auto& bucket : buckets_) {
+      for (const auto& entry : bucket) {
+        if (top == nullptr
+            || IsLater(top->event, top->slot, entry.event, entry.slot)) {
+          top = &entry;
+        }
+      }
+    }
+  }
+
+  if (top == nullptr) {
+    return;
+  }
+
+  current_day_ = top->day;
+  top_slot_ = top->slot;
+
+  double t {top->event.GetTime()};
+  if (t >= last_top_time_ && t != INFINITY) {
+    gaps_sum_ += t - last_top_time_;
+    ++gaps_count_;
+  }
+  last_top_time_ = t;
+}
+
+// Resizes the calendar when it holds too many or too few events per
+// bucket, or when the width of a day no longer matches the event rate.
+void CalendarQueue::Adapt() {
+  std::size_t buckets_count {buckets_.size()};
+  if (size_ > 2 * buckets_count) {
+    Rebuild(2 * buckets_count);
+  } else if (size_ < buckets_count / 2 && buckets_count > kMinBuckets) {
+    Rebuild(buckets_count / 2);
+  } else if (gaps_count_ >= buckets_count) {
+    // Checked once per year of events
+    double width {kDayWidth * gaps_sum_ / gaps_count_};
+    if (width > 0.0 && (width_ > 2 * width || 2 * width_ < width)) {
+      Rebuild(buckets_count);
+    } else {
+      gaps_sum_ = 0.0;
+      gaps_count_ = 0;
+    }
+  }
+}
+
+// Spreads every event over the specified number of buckets, with a new
+// day width.
+void CalendarQueue::Rebuild(std::size_t buckets_count) {
+  std::vector<Entry> entries;
+  entries.reserve(size_);
+  for (auto& bucket : buckets_) {
+    entries.insert(entries.end(), bucket.begin(), bucket.end());
+  }
+
+  // The width of a day follows the time between consecutive earliest events.
+  // Until enough of them are known, it is estimated from the events
+  // scheduled: about half of them occur before the median time.
+  double width {0.0};
+  if (gaps_count_ >= kMinBuckets * 8) {
+    width = kDayWidth * gaps_sum_ / gaps_count_;
+  } else if (entries.size() >= kMinBuckets * 8) {
+    std::vector<double> times;
+    times.reserve(entries.size());
+    for (const auto& entry : entries) {
+      times.push_back(entry.event.GetTime());
+    }
+    std::size_t middle {times.size() / 2};
+    std::nth_element(times.begin(), times.begin() + middle, times.end());
+    double earliest {*std::min_element(times.begin(), times.begin() + middle)};
+    width = kDayWidth * (times[middle] - earliest) / middle;
+  }
+  if (width > 0.0 && width != INFINITY) {
+    width_ = width;
+  }
+  gaps_sum_ = 0.0;
+  gaps_count_ = 0;
+
+  buckets_.assign(buckets_count, std::vector<Entry>());
+  size_ = 0;
+  top_slot_ = -1;
+  current_day_ = Day(INFINITY);
+  for (auto& entry : entries) {
+    entry.day = Day(entry.event.GetTime());
+    current_day_ = std::min(current_day_, entry.day);
+    Insert(entry);
+  }
+}
@@ -0,0 +1,204 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cmath>
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+#include "include/main.h"
+#include "include/cellGrid.h"
+#include "include/serializer.h"
+
+// Largest number of cells along each axis: tiny particles, or points, would
+// otherwise get billions of cells. Larger cells only cost more candidates.
+static constexpr int kMaxCells {2048};
+
+// Initializes an empty grid.
+CellGrid::CellGrid() :
+    n_ {1},
+    cell_size_ {WINDOW_SIZE},
+    first_column_ {0}, last_column_ {0} {}
+
+// Splits the window into cells at least min_cell_size wide, kMaxCells at most
+// along each axis, and empties them. Only the columns from first_column to
+// last_column may hold particles.
+void CellGrid::Reset(double min_cell_size, int particles_count,
+    int first_column, int last_column) {
+  // The margin accounts for particles slightly outside of their cell, after
+  // being pushed back inside the simulation box. Counted in double, as point
+  // particles (min_cell_size 0) overflow an int
+  double cells {floor(WINDOW_SIZE / (std::max(min_cell_size, 0.0)
+      + 2 * EPSILON))};
+  n_ = static_cast<int>(std::min(std::max(cells, 1.0),
+      static_cast<double>(kMaxCells)));
+  cell_size_ = static_cast<double>(WINDOW_SIZE) / n_;
+  first_column_ = std::max(first_column, 0);
+  last_column_ = last_column < 0 ? n_ - 1 : std::min(last_column, n_ - 1);
+
+  head_.assign((last_column_ - first_column_ + 1) * n_, -1);
+  next_.assign(particles_count, -1);
+  prev_.assign(particles_count, -1);
+  cell_.assign(particles_count, -1);
+}
+
+// Returns the index of the cell containing the point (rx, ry).
+int CellGrid::Locate(double rx, double ry) const {
+  int ix {static_cast<int>(floor(rx / cell_size_))};
+  int iy {static_cast<int>(floor(ry / cell_size_))};
+  ix = std::min(std::max(ix, 0), n_ - 1);
+  iy = std::min(std::max(iy, 0), n_ - 1);
+  return ix + iy * n_;
+}
+
+// Adds particle i to the specified cell.
+void CellGrid::Insert(int i, int cell) {
+  if (i >= static_cast<int>(cell_.size())) {
+    next_.resize(i + 1, -1);
+    prev_.resize(i + 1, -1);
+    cell_.resize(i + 1, -1);
+  }
+
+  cell_[i] = cell;
+  prev_[i] = -1;
+  next_[i] = head_[Head(cell)];
+  if (next_[i] != -1) {
+    prev_[next_[i]] = i;
+  }
+  head_[Head(cell)] = i;
+}
+
+// Removes particle i from its cell.
+void CellGrid::Remove(int i) {
+  if (prev_[i] != -1) {
+    next_[prev_[i]] = next_[i];
+  } else {
+    head_[Head(cell_[i])] = next_[i];
+  }
+  if (next_[i] != -1) {
+    prev_[next_[i]] = prev_[i];
+  }
+
+  cell_[i] = -1;
+  next_[i] = -1;
+  prev_[i] = -1;
+}
+
+// Moves particle i from its cell to the specified cell.
+void CellGrid::Move(int i, int cell) {
+  Remove(i);
+  Insert(i, cell);
+}
+
+// Returns the cell of particle i.
+int CellGrid::GetCell(int i) const {
+  return cell_[i];
+}
+
+// Returns the first particle of the specified cell, -1 if empty.
+int CellGrid::GetFirst(int cell) const {
+  return head_[Head(cell)];
+}
+
+// Returns the particle following particle i in its cell, -1 if last.
+int CellGrid::GetNext(int i) const {
+  return next_[i];
+}
+
+// Fills neighbours with the cells around the specified one (itself
+// included) and returns their number. Only the columns which may hold
+// particles are given.
+int CellGrid::GetNeighbors(int cell, int neighbors[9]) const {
+  int ix {cell % n_}, iy {cell / n_};
+  int count {0};
+  for (int y {std::max(iy - 1, 0)}; y <= std::min(iy + 1, n_ - 1); ++y) {
+    for (int x {std::max(ix - 1, first_column_)};
+        x <= std::min(ix + 1, last_column_); ++x) {
+      neighbors[count++] = x + y * n_;
+    }
+  }
+  return count;
+}
+
+// Returns the amount of time to cross the boundary of the cell along one
+// axis, given the cell's column (or row) index.
+double CellGrid::TimeToLeave(int index, double r, double v) const {
+  // Particles never leave the window: there is no cell to cross into
+  if (v > 0 && index < n_ - 1) {
+    return std::max((index + 1) * cell_size_ - r, 0.0) / v;
+  } else if (v < 0 && index > 0) {
+    return std::max(r - index * cell_size_, 0.0) / -v;
+  } else {
+    return INFINITY;
+  }
+}
+
+// Returns the amount of time for a particle in the specified cell, at
+// position (rx, ry) with velocity (vx, vy), to cross the cell's boundary.
+double CellGrid::TimeToLeaveCell(int cell, double rx, double ry,
+    double vx, double vy) const {
+  return fmin(TimeToLeave(cell % n_, rx, vx), TimeToLeave(cell / n_, ry, vy));
+}
+
+// Returns the cell a particle at position (rx, ry) with velocity (vx, vy)
+// enters when it leaves the specified cell.
+int CellGrid::GetNextCell(int cell, double rx, double ry,
+    double vx, double vy) const {
+  double dtX {TimeToLeave(cell % n_, rx, vx)};
+  double dtY {TimeToLeave(cell / n_, ry, vy)};
+  if (dtX == INFINITY && dtY == INFINITY) {
+    return cell;
+  } else if (dtX <= dtY) {
+    return vx > 0 ? cell + 1 : cell - 1;
+  } else {
+    return vy > 0 ? cell + n_ : cell - n_;
+  }
+}
+
+// Returns the width of a cell.
+double CellGrid::GetCellSize() const {
+  return cell_size_;
+}
+
+// Returns the number of cells along each axis.
+int CellGrid::GetSize() const {
+  return n_;
+}
+
+// Returns the column of the specified cell.
+int CellGrid::GetColumn(int cell) const {
+  return cell % n_;
+}
+
+// Returns the position of the specified cell in head_.
+int CellGrid::Head(int cell) const {
+  int columns {last_column_ - first_column_ + 1};
+  return cell % n_ - first_column_ + cell / n_ * columns;
+}
+
+// Writes the cells and their lists of particles, for a checkpoint. The
+// lists keep their order, which is the order neighbours are looked at in.
+void CellGrid::Save(Serializer* out) const {
+  out->Write(n_);
+  out->Write(cell_size_);
+  out->Write(first_column_);
+  out->Write(last_column_);
+  out->Write(head_);
+  out->Write(next_);
+  out->Write(prev_);
+  out->Write(cell_);
+}
+
+// Reads back the cells Save() wrote, and returns false if they are
+// inconsistent.
+bool CellGrid::Restore(Deserializer* in) {
+  if (!in->Read(&n_) || !in->Read(&cell_size_) || !in->Read(&first_column_)
+      || !in->Read(&last_column_) || !in->Read(&head_) || !in->Read(&next_)
+      || !in->Read(&prev_) || !in->Read(&cell_)) {
+    return false;
+  }
+  return n_ > 0 && first_column_ >= 0 && first_column_ <= last_column_
+      && last_column_ < n_
+      && head_.size() == static_cast<std::size_t>(
+          (last_column_ - first_column_ + 1) * n_)
+      && next_.size() == cell_.size() && prev_.size() == cell_.size();
+}
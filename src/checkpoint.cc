@@ -0,0 +1,157 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/checkpoint.h"
+
+// Header at the start of a checkpoint file, followed by the state.
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t size;
+};
+
+// First bytes of a checkpoint file.
+static constexpr char kCheckpointMagic[8] {'M', 'D', 'C', 'H', 'E', 'C', 'K',
+    0};
+
+// Version of the format, increased whenever the state saved changes.
+static constexpr uint32_t kCheckpointVersion {2};
+
+// Written as is: reads differently on a machine of the other byte order.
+static constexpr uint32_t kCheckpointByteOrder {0x01020304};
+
+// Initializes a writer with no file.
+CheckpointWriter::CheckpointWriter() :
+    has_pending_ {false},
+    failed_ {false},
+    checkpoints_ {0},
+    running_ {false}, closing_ {false} {}
+
+// Writes the checkpoint left and stops the writer thread.
+CheckpointWriter::~CheckpointWriter() {
+  Close();
+}
+
+// Starts the writer thread, writing checkpoints to the specified file.
+void CheckpointWriter::Open(const std::string& path) {
+  Close();
+
+  path_ = path;
+  temporary_path_ = path + ".tmp";
+  has_pending_ = false;
+  failed_ = false;
+  checkpoints_ = 0;
+  closing_ = false;
+  running_ = true;
+  thread_ = std::thread(&CheckpointWriter::Work, this);
+}
+
+// Hands the specified state over to the writer thread, leaving state empty.
+// A state not written yet is replaced, as it is out of date.
+void CheckpointWriter::Write(std::vector<char>* state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.swap(*state);
+    has_pending_ = true;
+  }
+  state->clear();
+  handed_.notify_one();
+}
+
+// Writes the checkpoint left and stops the writer thread.
+void CheckpointWriter::Close() {
+  if (!running_) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  handed_.notify_one();
+  thread_.join();
+  running_ = false;
+}
+
+// Returns the number of checkpoints written so far.
+long CheckpointWriter::GetCheckpoints() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return checkpoints_;
+}
+
+// Returns whether a checkpoint could not be written.
+bool CheckpointWriter::HasFailed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return failed_;
+}
+
+// Writes the states handed over until the writer closes. Each state goes to
+// a temporary file first, renamed over the checkpoint once complete.
+void CheckpointWriter::Work() {
+  std::vector<char> state;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      handed_.wait(lock, [this] { return closing_ || has_pending_; });
+      if (!has_pending_) {
+        return;
+      }
+      state.swap(pending_);
+      has_pending_ = false;
+    }
+
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+    header.version = kCheckpointVersion;
+    header.byte_order = kCheckpointByteOrder;
+    header.size = state.size();
+
+    bool written {false};
+    FILE* file {fopen(temporary_path_.c_str(), "wb")};
+    if (file != nullptr) {
+      written = fwrite(&header, sizeof(header), 1, file) == 1
+          && fwrite(state.data(), 1, state.size(), file) == state.size();
+      written = fclose(file) == 0 && written;
+    }
+    written = written
+        && std::rename(temporary_path_.c_str(), path_.c_str()) == 0;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (written) {
+      checkpoints_++;
+    } else {
+      failed_ = true;
+    }
+  }
+}
+
+// Reads the state of the checkpoint in the specified file, and returns false
+// if the file is not a checkpoint this version reads.
+bool ReadCheckpoint(const std::string& path, std::vector<char>* state) {
+  FILE* file {fopen(path.c_str(), "rb")};
+  if (file == nullptr) {
+    return false;
+  }
+
+  CheckpointHeader header;
+  bool valid {fread(&header, sizeof(header), 1, file) == 1
+      && std::memcmp(header.magic, kCheckpointMagic, sizeof(header.magic)) == 0
+      && header.version == kCheckpointVersion
+      && header.byte_order == kCheckpointByteOrder};
+  if (valid) {
+    state->resize(header.size);
+    valid = fread(state->data(), 1, state->size(), file) == state->size();
+  }
+  fclose(file);
+  return valid;
+}
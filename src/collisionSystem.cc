@@ -1,685 +1,729 @@
 // Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
 
-#include <queue>
-#include <cstdio>
-#include <ctime>
-#include <sstream>
-#include <random>
+#include <chrono>
 #include <cmath>
-#include <SFML/Graphics.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <utility>
+#include <vector>
 
 #include "include/main.h"
 #include "include/collisionSystem.h"
 #include "include/particle.h"
+#include "include/particleStore.h"
 #include "include/event.h"
-#include "include/hsv2rgb.h"
+#include "include/eventQueue.h"
+#include "include/overlaps.h"
+#include "include/pressureMeter.h"
+#include "include/serializer.h"
+#include "include/stats.h"
+#include "include/threadPool.h"
+
+// Slot of the redraw event in the event queue. Particle i uses slots 2i + 1
+// and 2i + 2, see Slot() and WallSlot().
+static constexpr int kRedrawSlot {0};
+
+// Number of particles from which every event is predicted in parallel.
+static constexpr std::size_t kParallelParticles {4096};
+
+// Window of simulation time the pressure is measured over by default, and
+// number of bins it is split into.
+static constexpr double kPressureWindow {10.0};
+static constexpr int kPressureBins {10};
+
+// Returns the seconds elapsed from start to end.
+static double Seconds(std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end) {
+  return std::chrono::duration<double>(end - start).count();
+}
+
+// Events timed: one in every kTimingSample of each type, which stands for
+// them all. Reading the clock at each event would cost as much as processing
+// the cheapest ones.
+static constexpr long kTimingSample {64};
 
-// Initializes a system with the specified collection of particles.
+// Initializes a system with the specified collection of particles, running
+// on the specified scheduler, and predicting events on the specified number
+// of threads.
 CollisionSystem::CollisionSystem(std::vector<Particle> particles,
-    double friction) :
-    window_ {sf::VideoMode(WINDOW_SIZE, WINDOW_SIZE),
-        "Molecular Dynamics", sf::Style::Titlebar | sf::Style::Close},
+    double friction, EventQueue::Type scheduler, int threads) :
     Hz_ {0.5},
+    queue_ {EventQueue::Create(scheduler)},
     time_ {0},
-    particles_ {particles},
-    friction_ {friction} {
-  // Initialize the window
-  window_.setFramerateLimit(60);
-
-  // Initialize priority queue with collision events and redraw event
-  for (auto& particle : particles_) {
-    Predict(&particle, BOX_SIZE, 0);
+    friction_ {friction},
+    wall_size_ {BOX_SIZE}, wall_speed_ {0.0},
+    collisions_ {0},
+    pressure_ {kPressureWindow, kPressureBins, 0.0},
+    threads_ {threads} {
+  for (const auto& particle : particles) {
+    particles_.Add(particle);
   }
+  BuildGrid();
 
-  // First redraw event
-  pq_.push(Event(Event::Type::kRedraw, 0));
+  // Initialize the event queue with collision events and redraw event
+  PredictAll();
 }
 
 // Empty constructor: prevents a segmentation fault.
 CollisionSystem::~CollisionSystem() {}
 
-// Updates priority queue with all new events for particle a.
-void CollisionSystem::Predict(Particle* a, double wall_size,
-    double wall_speed) {
-  if (a != nullptr) {
-    // Particle-particle collisions
-    for (auto& particle : particles_) {
-      double dt {a->TimeToHit(particle)};
+// Returns the system a checkpoint saved, running on the specified scheduler
+// and predicting events on the specified number of threads. Returns nullptr
+// if the checkpoint is inconsistent. The events are restored as they were:
+// predicting them again would compute them from other positions.
+std::unique_ptr<CollisionSystem> CollisionSystem::Restore(Deserializer* in,
+    EventQueue::Type scheduler, int threads) {
+  std::unique_ptr<CollisionSystem> system {
+      new CollisionSystem(scheduler, threads)};
+  uint64_t events_count {0};
+  if (!in->Read(&system->time_) || !in->Read(&system->friction_)
+      || !in->Read(&system->wall_size_) || !in->Read(&system->wall_speed_)
+      || !in->Read(&system->collisions_) || !in->Read(&system->stats_)
+      || !system->particles_.Restore(in) || !system->grid_.Restore(in)
+      || !in->Read(&events_count)) {
+    return nullptr;
+  }
+
+  int slots_count {2 * static_cast<int>(system->particles_.Size()) + 1};
+  std::vector<std::pair<int, Event>> events;
+  for (uint64_t k {0}; k < events_count; ++k) {
+    int slot {0};
+    Event event {Event::Type::kRedraw, 0.0};
+    if (!in->Read(&slot) || !in->Read(&event) || slot < 0
+        || slot >= slots_count) {
+      return nullptr;
+    }
+    events.push_back(std::make_pair(slot, event));
+  }
+  if (!in->IsDone()) {
+    return nullptr;
+  }
+  system->queue_->Assign(events);
+
+  // The pressure is measured again from the restart on
+  system->pressure_.Reset(kPressureWindow, system->time_);
+  return system;
+}
+
+// Stores the earliest event of particle a in its slot of the event queue:
+// collision with a particle of the neighbouring cells, or crossing into the
+// next cell. A collision with particle b also replaces the event of b if it
+// is earlier.
+void CollisionSystem::Predict(int a) {
+  if (a != Event::kNone) {
+    Synchronize(a);
+    FindCandidates(a, &candidates_);
+    for (int b : candidates_) {
+      Synchronize(b);
+    }
+    Event earliest {EarliestEvent(a, candidates_, &times_)};
+
+    // The collisions found may be earlier than the events of the other
+    // particles
+    for (unsigned int k {0}; k < candidates_.size(); ++k) {
+      double dt {times_[k]};
       if (dt != INFINITY && dt >= 0.0) {
-        pq_.push(Event(Event::Type::kParticleParticle, time_ + dt, a,
-            &particle));
+        double t {time_ + dt};
+        int slot {Slot(candidates_[k])};
+        if (!queue_->Contains(slot) || t < queue_->Get(slot).GetTime()) {
+          queue_->Update(slot, Event(Event::Type::kParticleParticle, t,
+              candidates_[k], a, particles_.GetCounts()[a]));
+        }
       }
     }
 
-    // Particle-wall collisions
-    double dtX {a->TimeToHitVerticalWall(wall_size, wall_speed)};
-    if (dtX != INFINITY) {
-      pq_.push(Event(Event::Type::kVerticalWall, time_ + dtX, a));
+    if (earliest.GetTime() != INFINITY) {
+      queue_->Update(Slot(a), earliest);
+    } else {
+      queue_->Remove(Slot(a));
     }
-    double dtY {a->TimeToHitHorizontalWall(wall_size, wall_speed)};
-    if (dtY != INFINITY) {
-      pq_.push(Event(Event::Type::kHorizontalWall, time_ + dtY, a));
+  }
+}
+
+// Stores the earliest collision of particle a with a wall in its wall slot
+// of the event queue.
+void CollisionSystem::PredictWalls(int a) {
+  if (a != Event::kNone) {
+    Synchronize(a);
+    Event earliest {EarliestWallEvent(a)};
+    if (earliest.GetTime() != INFINITY) {
+      queue_->Update(WallSlot(a), earliest);
+    } else {
+      queue_->Remove(WallSlot(a));
     }
   }
 }
 
-// Empties the priority queue and predicts all future events.
-void CollisionSystem::RegenerateEvents(double wall_size, double wall_speed) {
-  while (!pq_.empty()) {
-    pq_.pop();
+// Empties the event queue, rebuilds the cell grid and predicts all
+// future events.
+void CollisionSystem::RegenerateEvents() {
+  Synchronize();
+  BuildGrid();
+  PredictAll();
+}
+
+// Processes the next valid event and returns it.
+Event CollisionSystem::Step() {
+  // Get the next valid event from the event queue
+  Event e {NextValidEvent()};
+  bool timed {stats_.events[static_cast<int>(e.GetType())] % kTimingSample
+      == 0};
+  std::chrono::steady_clock::time_point start, advanced, end;
+  if (timed) {
+    start = std::chrono::steady_clock::now();
+  }
+
+  int a {e.GetParticleA()};
+  int b {e.GetParticleB()};
+
+  // Update the simulation clock, and the positions of the particles
+  // involved in the event only
+  Advance(e.GetTime());
+  if (a != Event::kNone) {
+    Synchronize(a);
+  }
+  if (b != Event::kNone) {
+    Synchronize(b);
+  }
+
+  // Process event. Bounces increment the collision counts of the particles,
+  // which invalidates the events of the other particles involving them.
+  switch (e.GetType()) {
+    // Particle-particle collision
+    case Event::Type::kParticleParticle:
+      pressure_.AddVirial(particles_.BounceOff(a, b, friction_));
+      collisions_++;
+      break;
+    // Particle-vertical wall collision
+    case Event::Type::kVerticalWall:
+      pressure_.AddWallImpulse(
+          particles_.BounceOffVerticalWall(a, wall_speed_));
+      collisions_++;
+      break;
+    // Particle-horizontal wall collision
+    case Event::Type::kHorizontalWall:
+      pressure_.AddWallImpulse(
+          particles_.BounceOffHorizontalWall(a, wall_speed_));
+      collisions_++;
+      break;
+    // Particle crossing into the next cell: its trajectory is unchanged, its
+    // other events remain valid
+    case Event::Type::kCellCrossing:
+      grid_.Move(a, grid_.GetNextCell(grid_.GetCell(a),
+          particles_.GetRx(a), particles_.GetRy(a),
+          particles_.GetVx(a), particles_.GetVy(a)));
+      break;
+    // Redraw event: every particle is moved so that front ends can sample
+    // the system, then the next redraw is scheduled
+    case Event::Type::kRedraw:
+      Synchronize();
+      queue_->Update(kRedrawSlot,
+          Event(Event::Type::kRedraw, time_ + 1.0 / Hz_));
+      break;
+    default:
+      printf("Error: event type invalid.\n");
+      exit(1);
+      break;
+  }
+
+  // Predict the next events for particles a and b, replacing the one that was
+  // just processed. Their wall events only change when they bounce.
+  if (timed) {
+    advanced = std::chrono::steady_clock::now();
+  }
+  Predict(a);
+  Predict(b);
+  if (e.GetType() != Event::Type::kCellCrossing) {
+    PredictWalls(a);
+    PredictWalls(b);
+  }
+  if (timed) {
+    end = std::chrono::steady_clock::now();
+    stats_.advance_seconds += kTimingSample * Seconds(start, advanced);
+    stats_.predict_seconds += kTimingSample * Seconds(advanced, end);
+  }
+
+  stats_.events[static_cast<int>(e.GetType())]++;
+  stats_.queue_high_water = std::max(stats_.queue_high_water, queue_->Size());
+  return e;
+}
+
+// Returns the time of the next valid event.
+double CollisionSystem::GetNextEventTime() {
+  return NextValidEvent().GetTime();
+}
+
+// Processes every event scheduled before time t, then moves the particles
+// to time t.
+void CollisionSystem::RunUntil(double t) {
+  while (NextValidEvent().GetTime() <= t) {
+    Step();
+  }
+
+  if (t > time_) {
+    Advance(t);
   }
-  for (auto& particle : particles_) {
-    Predict(&particle, wall_size, wall_speed);
+  Synchronize();
+}
+
+// Processes the next n valid events.
+void CollisionSystem::RunEvents(long n) {
+  for (long i {0}; i < n; ++i) {
+    Step();
   }
-  pq_.push(Event(Event::Type::kRedraw, time_));
 }
 
-// Redraws all particles.
-void CollisionSystem::Redraw(bool display_isosurface) {
-  if (display_isosurface == true && window_.isOpen()) {
-    constexpr int kPixelSize {static_cast<int>(BOX_SIZE * BOX_SIZE * 4)};
-    sf::Uint8 pixels[kPixelSize];
+// Adds a particle to the system, predicts its events and returns its
+// index.
+int CollisionSystem::AddParticle(const Particle& particle) {
+  int i {particles_.Add(particle)};
+
+  // A particle larger than the cells needs a new grid
+  if (2 * particle.GetRadius() + 2 * EPSILON > grid_.GetCellSize()) {
+    RegenerateEvents();
+    return i;
+  }
 
-    sf::Texture texture;
-    texture.create(BOX_SIZE, BOX_SIZE);
+  // Events refer to particles by index: they remain valid
+  Synchronize(i);
+  grid_.Insert(i, grid_.Locate(particles_.GetRx(i), particles_.GetRy(i)));
+  Predict(i);
+  PredictWalls(i);
+  return i;
+}
 
-    sf::Sprite sprite;
+// Removes particle i from the system, along with its events.
+void CollisionSystem::RemoveParticle(int i) {
+  if (!particles_.IsAlive(i)) {
+    return;
+  }
 
-    for (auto x {0}; x < BOX_SIZE; ++x) {
-      for (auto y {0}; y < BOX_SIZE; ++y) {
-        int index {static_cast<int>((x + y * BOX_SIZE) * 4)};
-        float sum {0};
-        for (const auto& particle : particles_) {
-          double rx {particle.GetRx()}, ry {particle.GetRy()};
-          double d {sqrt((x + 280 - rx) * (x + 280 - rx)
-              + (y + 280 - ry) * (y + 280 - ry))};
-          sum += 300 * particle.GetRadius() / d;
-        }
-        sum = fmin(sum, 360);
-        float r {0}, g {0}, b {0};
-        HSVtoRGB(sum, 1.0, 1.0, &r, &g, &b);
-        pixels[index] = r * 255;
-        pixels[index + 1] = g * 255;
-        pixels[index + 2] = b * 255;
-        pixels[index + 3] = 255;
+  // The events of the other particles involving it become invalid, and are
+  // replaced when they reach the top of the queue
+  queue_->Remove(Slot(i));
+  queue_->Remove(WallSlot(i));
+  grid_.Remove(i);
+  particles_.Remove(i);
+}
+
+// Returns the pairs of overlapping particles, each pair once with its
+// smaller index first.
+std::vector<std::pair<int, int>> CollisionSystem::FindOverlaps() {
+  Synchronize();
+  return ::FindOverlaps(particles_, grid_);
+}
+
+// Resolves overlapping particles with the specified policy, and returns the
+// number of overlapping pairs found.
+std::size_t CollisionSystem::ResolveOverlaps(OverlapPolicy policy) {
+  std::vector<std::pair<int, int>> overlaps {FindOverlaps()};
+
+  if (policy == OverlapPolicy::kRemoveYounger) {
+    for (const auto& overlap : overlaps) {
+      int i {overlap.first}, j {overlap.second};
+      // One of them may have been removed with another pair already
+      if (!particles_.IsAlive(i) || !particles_.IsAlive(j)) {
+        continue;
+      }
+      if (particles_.GetBirthdate(i) <= particles_.GetBirthdate(j)) {
+        RemoveParticle(j);
+      } else {
+        RemoveParticle(i);
       }
     }
-
-    texture.update(pixels);
-    sprite.setTexture(texture);
-    sprite.setPosition(280, 280);
-    sprite.setColor(sf::Color::White);
-    window_.draw(sprite);
   } else {
-    for (const auto& particle : particles_) {
-      particle.Draw(&window_);
+    // Pushing a pair apart may make it overlap with other particles: one
+    // pass only resolves the overlaps found
+    std::vector<int> moved_particles;
+    for (const auto& overlap : overlaps) {
+      particles_.PushApart(overlap.first, overlap.second);
+      moved_particles.push_back(overlap.first);
+      moved_particles.push_back(overlap.second);
+    }
+
+    std::sort(moved_particles.begin(), moved_particles.end());
+    moved_particles.erase(std::unique(moved_particles.begin(),
+        moved_particles.end()), moved_particles.end());
+    for (int i : moved_particles) {
+      Confine(i);
+      grid_.Move(i, grid_.Locate(particles_.GetRx(i), particles_.GetRy(i)));
+    }
+    for (int i : moved_particles) {
+      Predict(i);
+      PredictWalls(i);
     }
   }
+
+  return overlaps.size();
 }
 
-// Pauses the simulation.
-void CollisionSystem::Pause(sf::Keyboard::Key pause_key) {
-  bool pause {true};
-
-  while (pause == true) {
-    sf::Event event;
-    if (window_.pollEvent(event)) {
-      switch (event.type) {
-        case sf::Event::Closed:
-          pause = false;
-          window_.close();
-          break;
-        case sf::Event::KeyPressed:
-          if (event.key.code == sf::Keyboard::Escape) {
-            pause = false;
-            window_.close();
-          }
-          break;
-        case sf::Event::KeyReleased:
-          if (event.type == sf::Event::KeyReleased
-              && event.key.code == pause_key) {
-            pause = false;
-          }
-          break;
-        default:
-          break;
-      }
+// Moves every particle to the simulation clock time.
+void CollisionSystem::Synchronize() {
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i)) {
+      Synchronize(i);
     }
   }
 }
 
-void CollisionSystem::DrawText(const sf::Font& font, const std::string& str,
-    int character_size, sf::Color color, int x, int y) {
-  sf::Text text;
-  text.setFont(font);
-  text.setString(str);
-  text.setCharacterSize(character_size);
-  text.setFillColor(color);
-  text.setPosition(x, y);
-  window_.draw(text);
+// Returns the particles.
+const ParticleStore& CollisionSystem::GetParticles() const {
+  return particles_;
 }
 
-// Displays helper text.
-void CollisionSystem::DisplayHelp(const sf::Font& font) {
-  window_.clear(sf::Color::Black);
+// Returns the simulation clock time.
+double CollisionSystem::GetTime() const {
+  return time_;
+}
 
-  DrawText(font,
-      "Press A to add a new particle at a random position.", 20,
-      sf::Color::White, 0, 0);
+// Returns the size of the simulation box.
+double CollisionSystem::GetWallSize() const {
+  return wall_size_;
+}
 
-  DrawText(font,
-      "Press B to display/hide brownian motion.", 20,
-      sf::Color::White, 0, 30);
+// Returns the speed of the walls.
+double CollisionSystem::GetWallSpeed() const {
+  return wall_speed_;
+}
 
-  DrawText(font,
-      "Press C to clear brownian path.", 20,
-      sf::Color::White, 0, 60);
+// Sets the speed of the walls and updates the wall events accordingly.
+void CollisionSystem::SetWallSpeed(double wall_speed) {
+  wall_speed_ = wall_speed;
+  PredictWalls();
+}
 
-  DrawText(font,
-      "Press H to display/hide the help.", 20,
-      sf::Color::White, 0, 90);
+// Returns the number of collisions processed so far.
+long CollisionSystem::GetCollisions() const {
+  return collisions_;
+}
 
-  DrawText(font,
-      "Press I to visualise isosurface (WARNING: VERY POOR PERFORMANCES).", 20,
-      sf::Color::White, 0, 120);
+// Returns the average kinetic energy of the particles.
+double CollisionSystem::GetAverageKineticEnergy() const {
+  if (particles_.Count() == 0) {
+    return 0.0;
+  }
 
-  DrawText(font,
-      "Press P to display/hide the particles.", 20,
-      sf::Color::White, 0, 150);
+  return particles_.GetKineticEnergy() / particles_.Count();
+}
 
-  DrawText(font,
-      "Press O to clear overlapped particles.", 20,
-      sf::Color::White, 0, 180);
+// Returns the pressure (N/m) from the virial theorem. In two dimensions,
+// P A = N k T + W / (2 t), where N k T is the kinetic energy of the
+// particles, and W the sum over the collisions of the distance between the
+// centers of the particles times the momentum they exchange.
+double CollisionSystem::GetPressure() const {
+  double area {wall_size_ * wall_size_};
+  double duration {pressure_.GetDuration()};
+  double virial {duration > 0 ? pressure_.GetVirial() / (2 * duration) : 0.0};
+  return particles_.GetKineticEnergy() / (area * DISTANCE_UNIT * DISTANCE_UNIT)
+      + virial * MASS_UNIT * SPEED_UNIT * SPEED_UNIT
+      / (area * DISTANCE_UNIT * DISTANCE_UNIT);
+}
 
-  DrawText(font,
-      "Press S to display/hide the simulation.", 20,
-      sf::Color::White, 0, 210);
+// Returns the momentum the particles gave to the walls over the pressure
+// window, per second and per meter of wall (N/m). Time runs in units of
+// DISTANCE_UNIT / SPEED_UNIT seconds.
+double CollisionSystem::GetWallPressure() const {
+  double duration {pressure_.GetDuration()};
+  if (duration <= 0) {
+    return 0.0;
+  }
+  return pressure_.GetWallImpulse() * MASS_UNIT * SPEED_UNIT * SPEED_UNIT
+      / (duration * 4 * wall_size_ * DISTANCE_UNIT * DISTANCE_UNIT);
+}
 
-  DrawText(font,
-      "Press Space to pause/unpause or start the simulation.", 20,
-      sf::Color::White, 0, 240);
+// Sets the window of simulation time the pressure is measured over, and
+// starts measuring it again from now.
+void CollisionSystem::SetPressureWindow(double window) {
+  pressure_.Reset(window, time_);
+}
 
-  DrawText(font,
-      "Press the Up and Down arrows to change the size of the simulation box.",
-      20, sf::Color::White, 0, 270);
+// Starts counting the speeds of the particles in a histogram of buckets of
+// the specified size.
+void CollisionSystem::TrackSpeeds(double bucket_size) {
+  particles_.TrackSpeeds(bucket_size);
+}
 
-  DrawText(font,
-      "Press the Left and Right arrows to change the scale of the histogram.",
-      20, sf::Color::White, 0, 300);
+// Returns the number of events in the event queue.
+std::size_t CollisionSystem::GetQueueSize() const {
+  return queue_->Size();
+}
 
-  DrawText(font,
-      "Press Escape to quit the simulation.", 20,
-      sf::Color::White, 0, 330);
+// Returns the counters of the events processed so far, and of the time spent
+// on them. Render time is left to front ends.
+Stats CollisionSystem::GetStats() const {
+  Stats stats {stats_};
+  stats.overlaps = particles_.GetOverlaps();
+  return stats;
+}
 
-  DrawText(font,
-      "The histogram displays the real velocity distribution in red\n"
-      "and the Maxwell-Boltzmann probability density function in white.", 20,
-      sf::Color::White, 0, 450);
+// Writes the whole state of the system for a checkpoint, particles as of
+// their last update: synchronizing them first would change the run.
+void CollisionSystem::Save(Serializer* out) const {
+  out->Write(time_);
+  out->Write(friction_);
+  out->Write(wall_size_);
+  out->Write(wall_speed_);
+  out->Write(collisions_);
+  out->Write(stats_);
+  particles_.Save(out);
+  grid_.Save(out);
+
+  int slots_count {2 * static_cast<int>(particles_.Size()) + 1};
+  out->Write(static_cast<uint64_t>(queue_->Size()));
+  for (int slot {0}; slot < slots_count; ++slot) {
+    if (queue_->Contains(slot)) {
+      out->Write(slot);
+      out->Write(queue_->Get(slot));
+    }
+  }
+}
 
-  window_.display();
+// Sets the number of threads predicting every event at once, 0 for one per
+// hardware thread.
+void CollisionSystem::SetThreads(int threads) {
+  threads_ = threads;
+  pool_.reset();
+}
 
-  Pause(sf::Keyboard::H);
+// Initializes a system with no particles and no grid, to restore.
+CollisionSystem::CollisionSystem(EventQueue::Type scheduler, int threads) :
+    Hz_ {0.5},
+    queue_ {EventQueue::Create(scheduler)},
+    time_ {0},
+    friction_ {0.0},
+    wall_size_ {BOX_SIZE}, wall_speed_ {0.0},
+    collisions_ {0},
+    pressure_ {kPressureWindow, kPressureBins, 0.0},
+    threads_ {threads} {}
+
+// Returns the slot of the events of particle i with other particles and
+// cells in the event queue.
+int CollisionSystem::Slot(int i) const {
+  return 2 * i + 1;
 }
 
-// Displays physical quantities (temperature, pressure, etc.) and helper text.
-void CollisionSystem::DisplayCharacteristics(const sf::Font& font,
-    time_t elapsed_time, int collisions, double average_kinetic_energy,
-    double wall_size, double wall_speed, sf::Time frameTime) {
-  DrawText(font,
-      "Press H to display/hide the help.", 20,
-      sf::Color::White, 600, 90);
+// Returns the slot of the wall events of particle i in the event queue.
+int CollisionSystem::WallSlot(int i) const {
+  return 2 * i + 2;
+}
 
-  int fps {static_cast<int>(1 / (frameTime.asMicroseconds() * pow(10, -6)))};
-  if (fps < 0) {
-    fps = 0;
+// Fills candidates with the particles of the cells around particle a, which
+// it may collide with.
+void CollisionSystem::FindCandidates(int a,
+    std::vector<int>* candidates) const {
+  candidates->clear();
+  int neighbors[9];
+  int neighbors_count {grid_.GetNeighbors(grid_.GetCell(a), neighbors)};
+  for (int k {0}; k < neighbors_count; ++k) {
+    for (int b {grid_.GetFirst(neighbors[k])}; b != -1; b = grid_.GetNext(b)) {
+      if (b != a) {
+        candidates->push_back(b);
+      }
+    }
   }
-  DrawText(font,
-      "FPS: " + std::to_string(fps), 20,
-      sf::Color::White, WINDOW_SIZE - 100, 0);
+}
 
-  DrawText(font,
-      "Speed scale", 20,
-      sf::Color::White, WINDOW_SIZE - 200, 340);
+// Returns the earliest event of particle a: collision with one of the
+// candidates, or crossing into the next cell. Fills times with the
+// collision times of the candidates. The particles must be synchronized.
+Event CollisionSystem::EarliestEvent(int a, const std::vector<int>& candidates,
+    std::vector<double>* times) const {
+  Event earliest {Event::Type::kRedraw, INFINITY};
+
+  // Particle-particle collisions, with all the candidates at once
+  times->resize(candidates.size());
+  int first {particles_.TimeToHit(a, candidates.data(), candidates.size(),
+      times->data())};
+  if (first != -1 && (*times)[first] >= 0.0) {
+    int b {candidates[first]};
+    earliest = Event(Event::Type::kParticleParticle, time_ + (*times)[first],
+        a, b, particles_.GetCounts()[b]);
+  }
 
-  sf::VertexArray speed_scale(sf::Lines);
-  for (auto i {0}; i < 600; i += 2) {
-    for (auto j {0}; j < 2; ++j) {
-      float r {0}, g{0}, b {0};
-      HSVtoRGB(300 - i / 2, 1.0, 1.0, &r, &g, &b);
-      speed_scale.append(sf::Vertex(sf::Vector2f(WINDOW_SIZE - 160,
-          400 + i + j), sf::Color(r * 255, g * 255, b * 255)));
-      speed_scale.append(sf::Vertex(sf::Vector2f(WINDOW_SIZE - 100,
-          400 + i + j), sf::Color(r * 255, g * 255, b * 255)));
-    }
+  // Cell crossing
+  double dtC {grid_.TimeToLeaveCell(grid_.GetCell(a), particles_.GetRx(a),
+      particles_.GetRy(a), particles_.GetVx(a), particles_.GetVy(a))};
+  if (time_ + dtC < earliest.GetTime()) {
+    earliest = Event(Event::Type::kCellCrossing, time_ + dtC, a);
   }
 
-  window_.draw(speed_scale);
-
-  const double boltzmann_constant {1.3806503e-23};
-
-  DrawText(font,
-      "Particles count: " + std::to_string(particles_.size()), 20,
-      sf::Color::White, 0, 0);
-
-  std::string collisions_per_second {"0"};
-  if (elapsed_time != 0) {
-    collisions_per_second = std::to_string(collisions / elapsed_time);
-  }
-  DrawText(font,
-      "Collisions per second: " + collisions_per_second, 20,
-      sf::Color::White, 0, 30);
-
-  std::ostringstream streamEnerg;
-  streamEnerg << average_kinetic_energy;
-  std::string strEnerg = streamEnerg.str();
-  DrawText(font,
-      "Av. kinetic energy: " + strEnerg + "J", 20,
-      sf::Color::White, 0, 60);
-
-  double temperature {(2.0 / 3.0)
-      * average_kinetic_energy / boltzmann_constant};
-  std::ostringstream streamTemp;
-  streamTemp << temperature;
-  std::string strTemp = streamTemp.str();
-  DrawText(font,
-      "Temperature: " + strTemp + "K", 20,
-      sf::Color::White, 0, 90);
-
-  double pressure {(2.0 / 3.0) * average_kinetic_energy * particles_.size()
-      / (wall_size * DISTANCE_UNIT
-      * wall_size * DISTANCE_UNIT)};
-  std::ostringstream streamPress;
-  streamPress << pressure;
-  std::string strPress = streamPress.str();
-  DrawText(font,
-      "Pressure: " + strPress + "Pa", 20,
-      sf::Color::White, 0, 120);
-
-  double particles_area {0.0};
-  for (const auto& particle : particles_) {
-    particles_area += M_PI * pow(particle.GetRadius(), 2);
-  }
-  double packing_factor {particles_area / (wall_size * wall_size)};
-  DrawText(font,
-      "Packing factor: " + std::to_string(packing_factor * 100) + "%", 20,
-      sf::Color::White, 0, 150);
-
-  DrawText(font,
-      "Time: " + std::to_string(time_), 20,
-      sf::Color::White, 600, 0);
-
-  DrawText(font,
-      "Priority queue size: " + std::to_string(pq_.size()) , 20,
-      sf::Color::White, 600, 30);
-
-  DrawText(font,
-      "Wall speed: " + std::to_string(SPEED_UNIT * wall_speed / 2) , 20,
-      sf::Color::White, 600, 60);
-}
-
-// Display the velocity histogram.
-void CollisionSystem::DisplayVelocityHistogram(double horizontal_scale,
-    double average_kinetic_energy) {
-  int max_speed {0};
-  for (const auto& particle : particles_) {
-    if (particle.GetSpeed() > max_speed) {
-      max_speed = particle.GetSpeed();
-    }
+  return earliest;
+}
+
+// Returns the earliest collision of particle a with a wall. The particle
+// must be synchronized.
+Event CollisionSystem::EarliestWallEvent(int a) const {
+  Event earliest {Event::Type::kRedraw, INFINITY};
+  double dtX {particles_.TimeToHitVerticalWall(a, wall_size_, wall_speed_)};
+  if (dtX >= 0.0 && time_ + dtX < earliest.GetTime()) {
+    earliest = Event(Event::Type::kVerticalWall, time_ + dtX, a);
   }
+  double dtY {particles_.TimeToHitHorizontalWall(a, wall_size_,
+      wall_speed_)};
+  if (dtY >= 0.0 && time_ + dtY < earliest.GetTime()) {
+    earliest = Event(Event::Type::kHorizontalWall, time_ + dtY, a);
+  }
+  return earliest;
+}
 
-  max_speed++;
-  // const int max_speed {20};
-  const float bucket_size {0.02};
-  int number_of_buckets {static_cast<int>(ceil(max_speed / bucket_size))};
-
-  std::vector<int> speed_histogram(number_of_buckets);
-
-  for (auto& particle : particles_) {
-    int bucket {static_cast<int>(floor(particle.GetSpeed() / bucket_size))};
-    speed_histogram[bucket]++;
-  }
-
-  auto max_particles = std::max_element(speed_histogram.begin(),
-      speed_histogram.end());
-
-  for (auto i {0}; i < number_of_buckets; ++i) {
-    sf::RectangleShape line(sf::Vector2f(1000 * bucket_size / 4,
-        speed_histogram[i] * 270 / *max_particles));
-    line.rotate(180);
-    line.setFillColor(sf::Color::Red);
-    line.setPosition(horizontal_scale * (i + 1) * bucket_size / 2, WINDOW_SIZE - 5);
-    window_.draw(line);
-  }
-
-  sf::RectangleShape horizontal_line(sf::Vector2f(WINDOW_SIZE, 5));
-  horizontal_line.setFillColor(sf::Color::White);
-  horizontal_line.setPosition(0, WINDOW_SIZE - 5);
-  window_.draw(horizontal_line);
-
-  // Maxwell-Boltzmann probability density function
-  sf::VertexArray maxwell_boltzmann(sf::LinesStrip);
-  const double boltzmann_constant {1.3806503e-23};
-  double mass {MASS_UNIT};
-  double temperature {(2.0 / 3.0)
-      * average_kinetic_energy / boltzmann_constant};
-  for (double i {0}; i < number_of_buckets; i += 0.25) {
-    double y {pow(mass / (2 * M_PI * boltzmann_constant * temperature), 3 / 2)
-        * 4 * M_PI * pow(i * bucket_size * SPEED_UNIT, 2)
-        * exp(-mass * pow(i * bucket_size * SPEED_UNIT, 2)
-        / (2 * boltzmann_constant * temperature))};
-    maxwell_boltzmann.append(sf::Vector2f(horizontal_scale * i * bucket_size / 2,
-        WINDOW_SIZE - 5 - 150 * y));
-  }
-
-  window_.draw(maxwell_boltzmann);
-}
-
-// Simulates the system of particles for the specified amount of time
-int CollisionSystem::Simulate() {
-  // Initialize random device for random position and speed when adding new
-  // particles
-  std::mt19937 rng {std::random_device()()};
-  std::uniform_real_distribution<double> random_speed(-1, 1);
-  std::uniform_real_distribution<double> random_position(
-        (WINDOW_SIZE - BOX_SIZE) / 2 + particles_[0].GetRadius(),
-        (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE - particles_[0].GetRadius());
-
-  // Booleans for displaying isosurfaces, particles, brownian motion, etc.
-  bool display_isosurface {false};
-  bool display_particles {true};
-  bool display_brownian_path {false};
-  bool display_simulation {true};
-
-  // Histogram horizontal scale
-  double histogram_scale {1000};
-
-  // Brownian motion path
-  // Storing an index and not a pointer to the particle because of heap
-  // reallocation when calling std::vector::push_back()
-  sf::VertexArray brownian_path(sf::LinesStrip);
-  int brownian_particle_index = particles_.size() / 2;
-
-  // Initialize the font
-  sf::Font source_code_pro;
-  if (!source_code_pro.loadFromFile("etc/fonts/sourcecodepro.otf")) {
-    printf("Couldn't load Source Code Pro font.\n");
-    exit(1);
-  }
-
-  // Initialize the box
-  double wall_size {BOX_SIZE}, wall_speed {0.0};
-  sf::RectangleShape simulation_box(sf::Vector2f(wall_size, wall_size));
-  simulation_box.setPosition((WINDOW_SIZE - wall_size) / 2,
-      (WINDOW_SIZE - wall_size) / 2);
-  simulation_box.setFillColor(sf::Color::Black);
-  simulation_box.setOutlineThickness(5);
-  simulation_box.setOutlineColor(sf::Color::White);
-
-  // Initialize the timer and collisions counter
-  time_t start_time {time(nullptr)};
-  time_t elapsed_time {0};
-  int collisions {0};
-
-  // SFML Clock for the FPS counter
-  sf::Clock clock;
-  sf::Time frameTime {};
-
-  // Initial display before starting the simulation
-  window_.clear(sf::Color::Black);
-
-  DisplayCharacteristics(source_code_pro, elapsed_time, collisions,
-      0, wall_size, wall_speed, sf::Time {});
-  window_.draw(simulation_box);
-  Redraw(display_isosurface);
-
-  window_.display();
-
-  Pause(sf::Keyboard::Space);
-
-  // Main simulation loop
-  while (window_.isOpen() && !pq_.empty()) {
-    // printf("Time: %lf\n", time_);
-    // printf("PQ size: %lu\n", pq_.size());
-    sf::Event event;
-    // Process user events
-    if (window_.pollEvent(event)) {
-      switch (event.type) {
-        case sf::Event::Closed:
-          window_.close();
-          return 0;
-          break;
-        case sf::Event::KeyPressed:
-          if (event.key.code == sf::Keyboard::Escape) {
-            window_.close();
-            return 0;
-            continue;
-          }
-          break;
-        case sf::Event::KeyReleased:
-          // A: add a new particle
-          if (event.key.code == sf::Keyboard::A) {
-            particles_.push_back(Particle(time_,
-                random_position(rng), random_position(rng),
-                random_speed(rng), random_speed(rng),
-                particles_[0].GetRadius() / 2,
-                0.25,
-                sf::Color::Red));
-
-            // The event priority queue is regenerated to account for the new
-            // particle
-            RegenerateEvents(wall_size, wall_speed);
-          // B: display brownian path
-          } else if (event.key.code == sf::Keyboard::B) {
-              display_brownian_path = !display_brownian_path;
-          // C: clear the brownian path
-          } else if (event.key.code == sf::Keyboard::C) {
-            brownian_path.clear();
-          // H: display helper text
-          } else if (event.key.code == sf::Keyboard::H) {
-            DisplayHelp(source_code_pro);
-          // I: display isosurfaces
-          } else if (event.key.code == sf::Keyboard::I) {
-            display_isosurface = !display_isosurface;
-          // P: display particles
-          } else if (event.key.code == sf::Keyboard::P) {
-            display_particles = !display_particles;
-          // O: delete overlapped particles
-          } else if (event.key.code == sf::Keyboard::O) {
-            std::vector<Particle> overlapped_particles;
-            for (unsigned int i {0}; i < particles_.size(); ++i) {
-              for (unsigned int j {i}; j < particles_.size(); ++j) {
-                Particle a = particles_[i];
-                Particle b = particles_[j];
-                double t {a.TimeToHit(b)};
-                if (t < 0) {
-                  if (a.GetBirthdate() <= b.GetBirthdate()) {
-                    overlapped_particles.push_back(b);
-                  } else {
-                    overlapped_particles.push_back(a);
-                  }
-                }
-              }
-            }
-
-            for (const auto& particle : overlapped_particles) {
-              ptrdiff_t pos = distance(particles_.begin(),
-                  find(particles_.begin(), particles_.end(), particle));
-              particles_.erase(particles_.begin() + pos);
-            }
-
-            RegenerateEvents(wall_size, wall_speed);
-          // S: display the simulation
-          } else if (event.key.code == sf::Keyboard::S) {
-            display_simulation = !display_simulation;
-          // Space: pause the simulation
-          } else if (event.key.code == sf::Keyboard::Space) {
-            Pause(sf::Keyboard::Space);
-          // Down: wall speed down
-          } else if (event.key.code == sf::Keyboard::Down) {
-            wall_speed -= 0.1;
-            RegenerateEvents(wall_size, wall_speed);
-          // Up: wall speed up
-          } else if (event.key.code == sf::Keyboard::Up) {
-            wall_speed += 0.1;
-            RegenerateEvents(wall_size, wall_speed);
-          // Right: zoom in on histogram
-          } else if (event.key.code == sf::Keyboard::Right) {
-            histogram_scale += 100;
-          // Left : zoom out on histogram
-          } else if (event.key.code == sf::Keyboard::Left) {
-            histogram_scale -= 100;
-          }
-          break;
-        default:
-          break;
+// Predicts the events of every particle and replaces the events of the
+// queue with them, along with a redraw event now. Large systems are split
+// between the threads of the pool, each filling its own buffer of events;
+// the queue is then built at once.
+void CollisionSystem::PredictAll() {
+  auto start {std::chrono::steady_clock::now()};
+  Synchronize();
+
+  std::size_t count {particles_.Size()};
+  if (!pool_ && count >= kParallelParticles) {
+    pool_.reset(new ThreadPool(threads_));
+  }
+  int threads {pool_ ? pool_->GetThreads() : 1};
+
+  // Every particle is synchronized: the events of a particle are found
+  // without touching the others. Since a collision time is the same for
+  // both particles, the earliest collision of a particle is found among its
+  // own candidates.
+  std::vector<std::vector<std::pair<int, Event>>> buffers(threads);
+  auto predict = [this, &buffers](std::size_t begin, std::size_t end,
+      int thread) {
+    std::vector<std::pair<int, Event>>& buffer = buffers[thread];
+    std::vector<int> candidates;
+    std::vector<double> times;
+    for (std::size_t i {begin}; i < end; ++i) {
+      int a = i;
+      if (!particles_.IsAlive(a)) {
+        continue;
+      }
+      FindCandidates(a, &candidates);
+      Event earliest {EarliestEvent(a, candidates, &times)};
+      if (earliest.GetTime() != INFINITY) {
+        buffer.emplace_back(Slot(a), earliest);
+      }
+      Event wall {EarliestWallEvent(a)};
+      if (wall.GetTime() != INFINITY) {
+        buffer.emplace_back(WallSlot(a), wall);
       }
     }
+  };
+  if (pool_) {
+    pool_->ParallelFor(count, predict);
+  } else {
+    predict(0, count, 0);
+  }
 
-    // Get the next valid event from the priority queue
-    Event e = pq_.top();
-    pq_.pop();
-    while (e.IsValid() == false || e.GetTime() < time_) {
-      e = pq_.top();
-      pq_.pop();
-    }
-
-    Particle* a {e.GetParticleA()};
-    Particle* b {e.GetParticleB()};
-
-    Event::Type event_type {e.GetType()};
-
-    double average_kinetic_energy {0.0};
-
-    // Physical collision, update positions, simulation clock and
-    // calculate average kinetic energy
-    // 2 times wall_speed! wall_speed represents the speed of the whole height
-    // or width of the box. Thus, when changing e.g. the width, the speed gets
-    // "divided by two": half of it accounts for the left side, the other half
-    // for the right side.
+  // Buffers hold consecutive ranges of particles: the queue does not depend
+  // on the number of threads
+  std::vector<std::pair<int, Event>> events;
+  events.emplace_back(kRedrawSlot, Event(Event::Type::kRedraw, time_));
+  for (const auto& buffer : buffers) {
+    events.insert(events.end(), buffer.begin(), buffer.end());
+  }
+  queue_->Assign(events);
+  stats_.queue_high_water = std::max(stats_.queue_high_water, queue_->Size());
+  stats_.predict_seconds += Seconds(start, std::chrono::steady_clock::now());
+}
 
-    if (wall_size > WINDOW_SIZE) {
-      wall_size = WINDOW_SIZE;
-      wall_speed = 0;
+// Predicts the wall events of every particle.
+void CollisionSystem::PredictWalls() {
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i)) {
+      PredictWalls(i);
     }
-    wall_size += 2 * wall_speed * (e.GetTime() - time_);
-    simulation_box.setSize(sf::Vector2f(wall_size, wall_size));
-    simulation_box.setPosition((WINDOW_SIZE - wall_size) / 2,
-        (WINDOW_SIZE - wall_size) / 2);
-
-    for (auto& particle : particles_) {
-      particle.Move(e.GetTime() - time_);
-
-      // Ensures the particle stays inside the simulation box. Prevents floating
-      // point errors.
-      if (particle.GetRx() - particle.GetRadius()
-          < (WINDOW_SIZE - wall_size) / 2 - EPSILON) {
-        particle.SetRx((WINDOW_SIZE - wall_size) / 2 + particle.GetRadius());
-      }
-      if (particle.GetRx() + particle.GetRadius()
-          > (WINDOW_SIZE - wall_size) / 2 + wall_size + EPSILON) {
-        particle.SetRx((WINDOW_SIZE - wall_size) / 2 + wall_size
-            - particle.GetRadius());
-      }
-      if (particle.GetRy() - particle.GetRadius()
-          < (WINDOW_SIZE - wall_size) / 2 - EPSILON) {
-        particle.SetRy((WINDOW_SIZE - wall_size) / 2 + particle.GetRadius());
-      }
-      if (particle.GetRy() + particle.GetRadius()
-          > (WINDOW_SIZE - wall_size) / 2 + wall_size + EPSILON) {
-        particle.SetRy((WINDOW_SIZE - wall_size) / 2 + wall_size
-            - particle.GetRadius());
-      }
+  }
+}
 
-      average_kinetic_energy += particle.KineticEnergy();
+// Returns the earliest valid event, without removing it from the queue.
+const Event& CollisionSystem::NextValidEvent() {
+  // The other particle of an invalid event collided since the event was
+  // predicted: the event is replaced by the next one of its particle. The
+  // redraw event is always valid, so the queue never runs empty.
+  while (queue_->Top().IsValid(particles_.GetCounts()) == false) {
+    bool timed {stats_.invalid_events % kTimingSample == 0};
+    std::chrono::steady_clock::time_point start;
+    if (timed) {
+      start = std::chrono::steady_clock::now();
+    }
+    Predict(queue_->Top().GetParticleA());
+    if (timed) {
+      stats_.predict_seconds += kTimingSample
+          * Seconds(start, std::chrono::steady_clock::now());
+    }
+    stats_.invalid_events++;
+  }
+  return queue_->Top();
+}
 
-      // Change the particle's color based on its speed
-      float hue {static_cast<float>(particle.GetSpeed() * 300.0 / 3.0)};
-      float red {0}, green {0}, blue {0};
-      // Using HSV color space is easier to color the particles
-      HSVtoRGB(hue, 1.0, 1.0, &red, &green, &blue);
-      particle.SetColor(sf::Color(red * 255, green * 255, blue * 255));
+// Sizes the cell grid for the largest particle and fills it.
+void CollisionSystem::BuildGrid() {
+  double max_radius {0.0};
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i)) {
+      max_radius = std::max(max_radius, particles_.GetRadius(i));
     }
-    average_kinetic_energy /= particles_.size();
-    time_ = e.GetTime();
+  }
 
-    if (a == &(particles_[brownian_particle_index])) {
-      brownian_path.append(sf::Vector2f(a->GetRx(), a->GetRy()));
-    } else if (b == &(particles_[brownian_particle_index])) {
-      brownian_path.append(sf::Vector2f(b->GetRx(), b->GetRy()));
+  // No particles, or point particles only, get the finest grid
+  grid_.Reset(2 * max_radius, particles_.Size());
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i)) {
+      grid_.Insert(i, grid_.Locate(particles_.GetRx(i), particles_.GetRy(i)));
     }
+  }
+}
 
-    // Process event
-    switch (event_type) {
-      // Particle-particle collision
-      case Event::Type::kParticleParticle:
-        a->BounceOff(b, friction_);
-        collisions++;
-        break;
-      // Particle-vertical wall collision
-      case Event::Type::kVerticalWall:
-        a->BounceOffVerticalWall(wall_speed);
-        collisions++;
-        break;
-      // Particle-horizontal wall collision
-      case Event::Type::kHorizontalWall:
-        a->BounceOffHorizontalWall(wall_speed);
-        collisions++;
-        break;
-      // Redraw event
-      case Event::Type::kRedraw:
-        window_.clear(sf::Color::Black);
-
-        elapsed_time = time(nullptr) - start_time;
-        DisplayCharacteristics(source_code_pro, elapsed_time, collisions,
-            average_kinetic_energy, wall_size, wall_speed, frameTime);
-
-        DisplayVelocityHistogram(histogram_scale, average_kinetic_energy);
-
-        if (display_simulation) {
-          window_.draw(simulation_box);
-
-          if (display_particles) {
-            Redraw(display_isosurface);
-          }
-          if (display_brownian_path) {
-            window_.draw(brownian_path);
-          }
-        }
+// Moves the walls and the simulation clock to time t. Particles are only
+// moved when needed, see Synchronize().
+void CollisionSystem::Advance(double t) {
+  // 2 times wall_speed! wall_speed represents the speed of the whole height
+  // or width of the box. Thus, when changing e.g. the width, the speed gets
+  // "divided by two": half of it accounts for the left side, the other half
+  // for the right side.
+  bool walls_stopped {false};
+  if (wall_size_ > WINDOW_SIZE) {
+    wall_size_ = WINDOW_SIZE;
+    walls_stopped = wall_speed_ != 0;
+    wall_speed_ = 0;
+  }
+  wall_size_ += 2 * wall_speed_ * (t - time_);
 
-        window_.display();
+  time_ = t;
+  pressure_.Advance(t);
 
-        // FPS counter
-        frameTime = clock.restart();
+  // The wall events predicted with the former speed are wrong
+  if (walls_stopped) {
+    PredictWalls();
+  }
+}
 
-        // Add a redraw event to the priority queue
-        pq_.push(Event(Event::Type::kRedraw, time_ + 1.0 / Hz_));
-        break;
-      default:
-        printf("Error: event type invalid.\n");
-        exit(1);
-        break;
-    }
+// Moves particle i to the simulation clock time.
+void CollisionSystem::Synchronize(int i) {
+  if (particles_.GetTime(i) == time_) {
+    return;
+  }
+  particles_.Update(i, time_);
+  Confine(i);
+}
 
-    // Remove every invalid event from the priority queue
-    // Source of huge performance decrease
-    // But without it, the RAM gets eaten FAST
-    // std::vector<Event> temp_events {};
-    // while (!pq_.empty()) {
-    //   Event temp_e {pq_.top()};
-    //   pq_.pop();
-    //   if (temp_e.IsValid()) {
-    //     temp_events.push_back(temp_e);
-    //   }
-    // }
-    //
-    // for (const auto& ev : temp_events) {
-    //   pq_.push(ev);
-    // }
-
-    // Predict the next events for particles a and b
-    Predict(a, wall_size, wall_speed);
-    Predict(b, wall_size, wall_speed);
-  }
-
-  return 0;
+// Ensures particle i stays inside the simulation box. Prevents floating
+// point errors.
+void CollisionSystem::Confine(int i) {
+  double radius {particles_.GetRadius(i)};
+  if (particles_.GetRx(i) - radius
+      < (WINDOW_SIZE - wall_size_) / 2 - EPSILON) {
+    particles_.SetRx(i, (WINDOW_SIZE - wall_size_) / 2 + radius);
+  }
+  if (particles_.GetRx(i) + radius
+      > (WINDOW_SIZE - wall_size_) / 2 + wall_size_ + EPSILON) {
+    particles_.SetRx(i, (WINDOW_SIZE - wall_size_) / 2 + wall_size_ - radius);
+  }
+  if (particles_.GetRy(i) - radius
+      < (WINDOW_SIZE - wall_size_) / 2 - EPSILON) {
+    particles_.SetRy(i, (WINDOW_SIZE - wall_size_) / 2 + radius);
+  }
+  if (particles_.GetRy(i) + radius
+      > (WINDOW_SIZE - wall_size_) / 2 + wall_size_ + EPSILON) {
+    particles_.SetRy(i, (WINDOW_SIZE - wall_size_) / 2 + wall_size_ - radius);
+  }
 }
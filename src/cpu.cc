@@ -0,0 +1,13 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include "include/cpu.h"
+
+// Returns whether the CPU supports the AVX2 kernels.
+bool HasAvx2() {
+#ifdef MDSIM_AVX2
+  static const bool has_avx2 {__builtin_cpu_supports("avx2") != 0};
+  return has_avx2;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,724 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <vector>
+
+#include "include/main.h"
+#include "include/domain.h"
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/event.h"
+#include "include/eventQueue.h"
+#include "include/cellGrid.h"
+
+// Returns whether message a is to be processed before message b.
+static bool IsEarlier(const Message& a, const Message& b) {
+  if (a.time != b.time) {
+    return a.time < b.time;
+  }
+  if (a.from != b.from) {
+    return a.from < b.from;
+  }
+  if (a.id != b.id) {
+    return a.id < b.id;
+  }
+  return a.type < b.type;
+}
+
+// Returns whether messages a and b are the same.
+static bool IsSame(const Message& a, const Message& b) {
+  return a.type == b.type && a.from == b.from && a.to == b.to
+      && a.id == b.id && a.cell == b.cell && a.time == b.time
+      && a.state.rx == b.state.rx && a.state.ry == b.state.ry
+      && a.state.vx == b.state.vx && a.state.vy == b.state.vy
+      && a.state.time == b.state.time;
+}
+
+// Returns the time particles i and j collide at, INFINITY if they never do.
+// Both particles are moved to the later of their last bounces first: the
+// time found does not depend on when it is computed, nor on the order of
+// the particles.
+static double CollisionTime(const ParticleStore& particles, int i, int j) {
+  double t {std::max(particles.GetTime(i), particles.GetTime(j))};
+  double dx {(particles.GetRx(j) + particles.GetVx(j)
+      * (t - particles.GetTime(j))) - (particles.GetRx(i)
+      + particles.GetVx(i) * (t - particles.GetTime(i)))};
+  double dy {(particles.GetRy(j) + particles.GetVy(j)
+      * (t - particles.GetTime(j))) - (particles.GetRy(i)
+      + particles.GetVy(i) * (t - particles.GetTime(i)))};
+  double dvx {particles.GetVx(j) - particles.GetVx(i)};
+  double dvy {particles.GetVy(j) - particles.GetVy(i)};
+
+  double dvdr {dx * dvx + dy * dvy};
+  if (dvdr >= 0) {
+    return INFINITY;
+  }
+
+  // Overlapping particles only come from messages processed too early, and
+  // are rolled back
+  double sigma {particles.GetRadius(i) + particles.GetRadius(j)};
+  double gap {dx * dx + dy * dy - sigma * sigma};
+  double dvdv {dvx * dvx + dvy * dvy};
+  double d {dvdr * dvdr - dvdv * gap};
+  if (gap < 0 || d < 0) {
+    return INFINITY;
+  }
+  return t - (dvdr + sqrt(d)) / dvdv;
+}
+
+// Returns the particle carried by the specified message.
+static Particle ToParticle(const Message& message) {
+  return Particle(message.birthdate, message.state.rx, message.state.ry,
+      message.state.vx, message.state.vy, message.radius, message.mass);
+}
+
+// Initializes an empty domain, the index-th from the left, made of the
+// specified columns of a grid of cells at least min_cell_size wide.
+Domain::Domain(int index, int first_column, int last_column,
+    double min_cell_size, double friction, double wall_size,
+    EventQueue::Type scheduler) :
+    index_ {index},
+    first_column_ {first_column}, last_column_ {last_column},
+    friction_ {friction}, wall_size_ {wall_size},
+    queue_ {EventQueue::Create(scheduler)},
+    time_ {0},
+    next_message_ {0},
+    collisions_ {0}, events_ {0}, rollbacks_ {0},
+    logging_ {false} {
+  // Ghosts lie in the column after the last one
+  grid_.Reset(min_cell_size, 0, first_column - 1, last_column + 1);
+}
+
+// Adds the particle of the specified index in the whole system, either its
+// own or the ghost of a particle of the next domain.
+void Domain::Add(int id, const Particle& particle, bool ghost) {
+  Add(id, particle, particle.GetBirthdate(),
+      grid_.Locate(particle.GetRx(), particle.GetRy()), ghost);
+}
+
+// Predicts the events of every particle, at the specified time.
+void Domain::Start(double time) {
+  time_ = time;
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i) && !ghosts_[i]) {
+      Predict(i);
+      PredictWalls(i);
+    }
+  }
+  logging_ = true;
+}
+
+// Takes the messages of the neighbouring domains into account, rolling back
+// to the earliest of them if needed.
+void Domain::Receive(const std::vector<Message>& messages) {
+  if (messages.empty()) {
+    return;
+  }
+
+  double earliest {INFINITY};
+  for (const auto& message : messages) {
+    earliest = std::min(earliest, message.time);
+  }
+  RollBack(earliest);
+
+  // Messages left to process are kept sorted; cancelled ones were never
+  // processed since the domain rolled back before them
+  for (const auto& message : messages) {
+    auto first = received_.begin() + next_message_;
+    if (message.cancel) {
+      auto found = std::find_if(first, received_.end(),
+          [&message](const Message& other) {
+            return IsSame(message, other);
+          });
+      if (found != received_.end()) {
+        received_.erase(found);
+      }
+    } else {
+      received_.insert(std::upper_bound(first, received_.end(), message,
+          IsEarlier), message);
+    }
+  }
+}
+
+// Processes at most count messages and events before time end, and returns
+// how many it processed. Messages go first when they are simultaneous with
+// an event.
+long Domain::Run(double end, long count) {
+  long processed {0};
+  for (;;) {
+    const Event* event {NextValidEvent()};
+    double event_time {event == nullptr ? INFINITY : event->GetTime()};
+    double message_time {next_message_ < received_.size()
+        ? received_[next_message_].time : INFINITY};
+    double next {std::min(event_time, message_time)};
+
+    // The messages sent before rolling back and not sent again by now never
+    // will be: they were wrong
+    std::size_t wrong {0};
+    while (wrong < unconfirmed_.size() && unconfirmed_[wrong].time < next) {
+      unconfirmed_[wrong].cancel = true;
+      outbox_.push_back(unconfirmed_[wrong++]);
+    }
+    unconfirmed_.erase(unconfirmed_.begin(), unconfirmed_.begin() + wrong);
+
+    if (next >= end || processed == count) {
+      break;
+    }
+    if (message_time <= event_time) {
+      Process(Message(received_[next_message_]));
+    } else {
+      Process(Event(*event));
+    }
+    ++processed;
+  }
+  return processed;
+}
+
+// Returns the messages sent since the last call, and forgets them.
+std::vector<Message> Domain::TakeMessages() {
+  std::vector<Message> messages;
+  messages.swap(outbox_);
+  return messages;
+}
+
+// Returns the time of the earliest message or event left to process.
+double Domain::GetNextTime() {
+  const Event* event {NextValidEvent()};
+  double next {event == nullptr ? INFINITY : event->GetTime()};
+  if (next_message_ < received_.size()) {
+    next = std::min(next, received_[next_message_].time);
+  }
+  return next;
+}
+
+// Forgets how to roll back before time t.
+void Domain::Commit(double t) {
+  auto changes = std::find_if(changes_.begin(), changes_.end(),
+      [t](const Change& change) { return change.time >= t; });
+  changes_.erase(changes_.begin(), changes);
+
+  auto sent = std::find_if(sent_.begin(), sent_.end(),
+      [t](const Message& message) { return message.time >= t; });
+  sent_.erase(sent_.begin(), sent);
+
+  std::size_t processed {0};
+  while (processed < next_message_ && received_[processed].time < t) {
+    ++processed;
+  }
+  received_.erase(received_.begin(), received_.begin() + processed);
+  next_message_ -= processed;
+}
+
+// Moves the particles of the domain to time t, and copies them into the
+// specified store, at the index of each particle in the whole system. The
+// totals of the store are left out of date.
+void Domain::Collect(double t, ParticleStore* particles) {
+  for (unsigned int i {0}; i < particles_.Size(); ++i) {
+    if (particles_.IsAlive(i) && !ghosts_[i]) {
+      particles->SetStateOnly(ids_[i], particles_.GetState(i));
+      particles->Update(ids_[i], t);
+    }
+  }
+}
+
+// Returns the number of collisions processed so far.
+long Domain::GetCollisions() const {
+  return collisions_;
+}
+
+// Returns the number of messages and events processed so far, those undone
+// included.
+long Domain::GetEvents() const {
+  return events_;
+}
+
+// Returns the number of messages and events undone so far.
+long Domain::GetRollbacks() const {
+  return rollbacks_;
+}
+
+// Returns the slot of the events of particle i with other particles and
+// cells in the event queue.
+int Domain::Slot(int i) const {
+  return 2 * i;
+}
+
+// Returns the slot of the wall events of particle i in the event queue.
+int Domain::WallSlot(int i) const {
+  return 2 * i + 1;
+}
+
+// Returns whether particle i is a particle of the first column, which the
+// previous domain keeps a ghost of.
+bool Domain::IsShared(int i) const {
+  return index_ > 0 && !ghosts_[i]
+      && grid_.GetColumn(grid_.GetCell(i)) == first_column_;
+}
+
+// Stores the earliest event of particle a in its slot of the event queue.
+void Domain::Predict(int a) {
+  Event earliest {Event::Type::kRedraw, INFINITY};
+  int neighbors[9];
+  int neighbors_count {grid_.GetNeighbors(grid_.GetCell(a), neighbors)};
+  for (int k {0}; k < neighbors_count; ++k) {
+    for (int b {grid_.GetFirst(neighbors[k])}; b != -1; b = grid_.GetNext(b)) {
+      double t {b == a ? INFINITY : CollisionTime(particles_, a, b)};
+      if (t == INFINITY || t < time_) {
+        continue;
+      }
+      if (t < earliest.GetTime()) {
+        earliest = Event(Event::Type::kParticleParticle, t, a, b,
+            particles_.GetCounts()[b]);
+      }
+
+      // The collision may be earlier than the event of b. Ghosts have no
+      // events: their own domain predicts them.
+      if (!ghosts_[b] && (!queue_->Contains(Slot(b))
+          || t < queue_->Get(Slot(b)).GetTime())) {
+        queue_->Update(Slot(b), Event(Event::Type::kParticleParticle, t,
+            b, a, particles_.GetCounts()[a]));
+      }
+    }
+  }
+
+  // Cell crossing, possibly into another domain
+  double tC {particles_.GetTime(a) + grid_.TimeToLeaveCell(grid_.GetCell(a),
+      particles_.GetRx(a), particles_.GetRy(a), particles_.GetVx(a),
+      particles_.GetVy(a))};
+  if (tC < earliest.GetTime()) {
+    earliest = Event(Event::Type::kCellCrossing, std::max(tC, time_), a);
+  }
+
+  if (earliest.GetTime() != INFINITY) {
+    queue_->Update(Slot(a), earliest);
+  } else {
+    queue_->Remove(Slot(a));
+  }
+}
+
+// Stores the earliest collision of particle a with a wall in its wall slot
+// of the event queue. The walls of a domain do not move.
+void Domain::PredictWalls(int a) {
+  Event earliest {Event::Type::kRedraw, INFINITY};
+  double tX {particles_.GetTime(a)
+      + particles_.TimeToHitVerticalWall(a, wall_size_, 0.0)};
+  if (tX < earliest.GetTime()) {
+    earliest = Event(Event::Type::kVerticalWall, std::max(tX, time_), a);
+  }
+  double tY {particles_.GetTime(a)
+      + particles_.TimeToHitHorizontalWall(a, wall_size_, 0.0)};
+  if (tY < earliest.GetTime()) {
+    earliest = Event(Event::Type::kHorizontalWall, std::max(tY, time_), a);
+  }
+  if (earliest.GetTime() != INFINITY) {
+    queue_->Update(WallSlot(a), earliest);
+  } else {
+    queue_->Remove(WallSlot(a));
+  }
+}
+
+// Stores the collisions of ghost g with the particles of the domain in
+// their slots of the event queue, when they are earlier.
+void Domain::PredictGhost(int g) {
+  int neighbors[9];
+  int neighbors_count {grid_.GetNeighbors(grid_.GetCell(g), neighbors)};
+  for (int k {0}; k < neighbors_count; ++k) {
+    for (int b {grid_.GetFirst(neighbors[k])}; b != -1; b = grid_.GetNext(b)) {
+      if (ghosts_[b]) {
+        continue;
+      }
+      double t {CollisionTime(particles_, g, b)};
+      if (t != INFINITY && t >= time_ && (!queue_->Contains(Slot(b))
+          || t < queue_->Get(Slot(b)).GetTime())) {
+        queue_->Update(Slot(b), Event(Event::Type::kParticleParticle, t,
+            b, g, particles_.GetCounts()[g]));
+      }
+    }
+  }
+}
+
+// Returns the earliest valid event, nullptr if none.
+const Event* Domain::NextValidEvent() {
+  while (!queue_->Empty()
+      && queue_->Top().IsValid(particles_.GetCounts()) == false) {
+    Predict(queue_->Top().GetParticleA());
+  }
+  return queue_->Empty() ? nullptr : &queue_->Top();
+}
+
+// Processes the specified event. Particle a of an event is always a
+// particle of the domain; particle b may be a ghost.
+void Domain::Process(const Event& event) {
+  int a {event.GetParticleA()};
+  int b {event.GetParticleB()};
+
+  time_ = event.GetTime();
+  ++events_;
+  if (logging_) {
+    Log(Change::Type::kEvent, -1);
+  }
+
+  switch (event.GetType()) {
+    // Particle-particle collision: the domain on the right is told about
+    // the new trajectory of a ghost, and the domain on the left about the
+    // new trajectories of the particles of the first column
+    case Event::Type::kParticleParticle:
+      if (logging_) {
+        Log(Change::Type::kState, a);
+        Log(Change::Type::kState, b);
+        Log(Change::Type::kCollision, -1);
+      }
+      Advance(a);
+      Advance(b);
+      particles_.BounceOff(a, b, friction_);
+      collisions_++;
+      if (IsShared(a)) {
+        Send(MakeMessage(Message::Type::kGhost, index_ - 1, a));
+      }
+      if (ghosts_[b]) {
+        Send(MakeMessage(Message::Type::kImpose, index_ + 1, b));
+      } else if (IsShared(b)) {
+        Send(MakeMessage(Message::Type::kGhost, index_ - 1, b));
+      }
+      Predict(a);
+      if (ghosts_[b]) {
+        PredictGhost(b);
+      } else {
+        Predict(b);
+        PredictWalls(b);
+      }
+      PredictWalls(a);
+      break;
+    // Particle-wall collisions
+    case Event::Type::kVerticalWall:
+    case Event::Type::kHorizontalWall:
+      if (logging_) {
+        Log(Change::Type::kState, a);
+        Log(Change::Type::kCollision, -1);
+      }
+      Advance(a);
+      if (event.GetType() == Event::Type::kVerticalWall) {
+        particles_.BounceOffVerticalWall(a, 0.0);
+      } else {
+        particles_.BounceOffHorizontalWall(a, 0.0);
+      }
+      collisions_++;
+      if (IsShared(a)) {
+        Send(MakeMessage(Message::Type::kGhost, index_ - 1, a));
+      }
+      Predict(a);
+      PredictWalls(a);
+      break;
+    // Particle crossing into the next cell, possibly in another domain: its
+    // trajectory is unchanged
+    case Event::Type::kCellCrossing: {
+      int cell {grid_.GetNextCell(grid_.GetCell(a), particles_.GetRx(a),
+          particles_.GetRy(a), particles_.GetVx(a), particles_.GetVy(a))};
+      int column {grid_.GetColumn(cell)};
+      if (column < first_column_ || column > last_column_) {
+        int to {column < first_column_ ? index_ - 1 : index_ + 1};
+        Message message {MakeMessage(Message::Type::kMigrate, to, a)};
+        message.cell = cell;
+        Send(message);
+
+        // A particle crossing into the next domain becomes a ghost; the
+        // previous domain already has one of a particle crossing into it
+        int id {ids_[a]};
+        Particle particle {particles_.Get(a)};
+        double time {particles_.GetTime(a)};
+        Remove(a);
+        if (to == index_ + 1) {
+          PredictGhost(Add(id, particle, time, cell, true));
+        }
+      } else {
+        bool shared {IsShared(a)};
+        Move(a, cell);
+        if (IsShared(a)) {
+          Send(MakeMessage(Message::Type::kGhost, index_ - 1, a));
+        } else if (shared) {
+          Send(MakeMessage(Message::Type::kLeave, index_ - 1, a));
+        }
+        Predict(a);
+      }
+      break;
+    }
+    default:
+      printf("Error: event type invalid.\n");
+      exit(1);
+      break;
+  }
+}
+
+// Processes the specified message. Messages about unknown particles, e.g.
+// after a message cancelled later, are ignored.
+void Domain::Process(const Message& message) {
+  time_ = message.time;
+  ++events_;
+  ++next_message_;
+  if (logging_) {
+    Log(Change::Type::kMessage, -1);
+  }
+
+  auto found = indices_.find(message.id);
+  int i {found == indices_.end() ? -1 : found->second};
+  switch (message.type) {
+    // A particle of the next domain changed, or entered its first column
+    case Message::Type::kGhost:
+      if (i == -1) {
+        i = Add(message.id, ToParticle(message), message.state.time,
+            message.cell, true);
+      } else if (ghosts_[i]) {
+        SetState(i, message.state);
+        if (grid_.GetCell(i) != message.cell) {
+          Move(i, message.cell);
+        }
+      } else {
+        break;
+      }
+      PredictGhost(i);
+      break;
+    // A particle left the first column of the next domain
+    case Message::Type::kLeave:
+      if (i != -1 && ghosts_[i]) {
+        Remove(i);
+      }
+      break;
+    // A particle of the domain collided with a particle of the previous one
+    case Message::Type::kImpose:
+      if (i != -1 && !ghosts_[i]) {
+        SetState(i, message.state);
+        Predict(i);
+        PredictWalls(i);
+      }
+      break;
+    // A particle crossed into the domain, from a neighbouring one: the
+    // ghost of a particle coming from the next domain becomes a particle
+    case Message::Type::kMigrate:
+      if (i != -1) {
+        if (!ghosts_[i]) {
+          break;
+        }
+        Remove(i);
+      }
+      i = Add(message.id, ToParticle(message), message.state.time,
+          message.cell, false);
+      Predict(i);
+      PredictWalls(i);
+      break;
+  }
+}
+
+// Undoes every change made at time t or later, in reverse order, then
+// predicts the events of the particles changed again.
+void Domain::RollBack(double t) {
+  undone_.clear();
+  while (!changes_.empty() && changes_.back().time >= t) {
+    Change change {changes_.back()};
+    changes_.pop_back();
+    int i {change.i};
+    switch (change.type) {
+      case Change::Type::kState:
+        particles_.SetState(i, change.state);
+        undone_.push_back(i);
+        break;
+      case Change::Type::kCell:
+        grid_.Move(i, change.cell);
+        undone_.push_back(i);
+        break;
+      case Change::Type::kAdd:
+        if (!ghosts_[i]) {
+          queue_->Remove(Slot(i));
+          queue_->Remove(WallSlot(i));
+        }
+        grid_.Remove(i);
+        indices_.erase(ids_[i]);
+        particles_.Remove(i);
+        break;
+      case Change::Type::kRemove:
+        // Indices are freed and reused last in, first out: undoing removals
+        // and additions in reverse order gives back the same indices
+        if (particles_.Add(Particle(change.birthdate, change.state.rx,
+            change.state.ry, change.state.vx, change.state.vy, change.radius,
+            change.mass)) != i) {
+          printf("Error: particle index lost when rolling back.\n");
+          exit(1);
+        }
+        particles_.SetState(i, change.state);
+        ids_[i] = change.id;
+        ghosts_[i] = change.ghost;
+        indices_[change.id] = i;
+        grid_.Insert(i, change.cell);
+        undone_.push_back(i);
+        break;
+      case Change::Type::kEvent:
+      case Change::Type::kMessage:
+        rollbacks_++;
+        break;
+      case Change::Type::kCollision:
+        collisions_--;
+        break;
+    }
+  }
+  next_message_ = std::lower_bound(received_.begin(),
+      received_.begin() + next_message_, t,
+      [](const Message& message, double time) {
+        return message.time < time;
+      }) - received_.begin();
+  time_ = std::min(time_, t);
+
+  // Messages sent since then may have to be sent again, or cancelled
+  auto sent = std::find_if(sent_.begin(), sent_.end(),
+      [t](const Message& message) { return message.time >= t; });
+  unconfirmed_.insert(unconfirmed_.begin(), sent, sent_.end());
+  sent_.erase(sent, sent_.end());
+  std::stable_sort(unconfirmed_.begin(), unconfirmed_.end(),
+      [](const Message& a, const Message& b) { return a.time < b.time; });
+
+  std::sort(undone_.begin(), undone_.end());
+  undone_.erase(std::unique(undone_.begin(), undone_.end()), undone_.end());
+  for (int i : undone_) {
+    if (!particles_.IsAlive(i)) {
+      continue;
+    }
+    if (ghosts_[i]) {
+      PredictGhost(i);
+    } else {
+      Predict(i);
+      PredictWalls(i);
+    }
+  }
+}
+
+// Sends a message to the neighbouring domain, unless the same message was
+// sent before rolling back.
+void Domain::Send(Message message) {
+  // Messages are sent in time order: those sent before rolling back and
+  // earlier than this one will not be sent again
+  auto later = std::find_if(unconfirmed_.begin(), unconfirmed_.end(),
+      [&message](const Message& other) {
+        return other.time > message.time;
+      });
+  for (auto it = unconfirmed_.begin(); it != later; ++it) {
+    if (IsSame(*it, message)) {
+      sent_.push_back(*it);
+      unconfirmed_.erase(it);
+      return;
+    }
+  }
+
+  outbox_.push_back(message);
+  sent_.push_back(message);
+}
+
+// Returns a message of the specified type about particle i, as of now.
+Message Domain::MakeMessage(Message::Type type, int to, int i) const {
+  Message message;
+  message.type = type;
+  message.cancel = false;
+  message.from = index_;
+  message.to = to;
+  message.id = ids_[i];
+  message.cell = grid_.GetCell(i);
+  message.time = time_;
+  message.radius = particles_.GetRadius(i);
+  message.mass = particles_.GetMass(i);
+  message.birthdate = particles_.GetBirthdate(i);
+  message.state = particles_.GetState(i);
+  return message;
+}
+
+// Adds a particle, positioned as of the specified time, with its cell, and
+// returns its index.
+int Domain::Add(int id, const Particle& particle, double time, int cell,
+    bool ghost) {
+  int i {particles_.Add(particle)};
+  ParticleStore::State state {particles_.GetState(i)};
+  state.time = time;
+  particles_.SetState(i, state);
+
+  if (static_cast<std::size_t>(i) >= ids_.size()) {
+    ids_.resize(i + 1);
+    ghosts_.resize(i + 1);
+  }
+  ids_[i] = id;
+  ghosts_[i] = ghost;
+  indices_[id] = i;
+  grid_.Insert(i, cell);
+  if (logging_) {
+    Log(Change::Type::kAdd, i);
+  }
+  return i;
+}
+
+// Removes particle i, along with its events.
+void Domain::Remove(int i) {
+  if (logging_) {
+    Log(Change::Type::kRemove, i);
+  }
+  if (!ghosts_[i]) {
+    queue_->Remove(Slot(i));
+    queue_->Remove(WallSlot(i));
+  }
+  grid_.Remove(i);
+  indices_.erase(ids_[i]);
+  particles_.Remove(i);
+}
+
+// Sets the state of particle i, remembering the former one.
+void Domain::SetState(int i, const ParticleStore::State& state) {
+  if (logging_) {
+    Log(Change::Type::kState, i);
+  }
+  particles_.SetState(i, state);
+}
+
+// Moves particle i to the specified cell, remembering the former one.
+void Domain::Move(int i, int cell) {
+  if (logging_) {
+    Log(Change::Type::kCell, i);
+  }
+  grid_.Move(i, cell);
+}
+
+// Moves particle i to the domain clock time, keeping it inside the
+// simulation box, before it bounces. Prevents floating point errors.
+void Domain::Advance(int i) {
+  particles_.Update(i, time_);
+  double radius {particles_.GetRadius(i)};
+  double low {(WINDOW_SIZE - wall_size_) / 2};
+  double high {low + wall_size_};
+  if (particles_.GetRx(i) - radius < low - EPSILON) {
+    particles_.SetRx(i, low + radius);
+  }
+  if (particles_.GetRx(i) + radius > high + EPSILON) {
+    particles_.SetRx(i, high - radius);
+  }
+  if (particles_.GetRy(i) - radius < low - EPSILON) {
+    particles_.SetRy(i, low + radius);
+  }
+  if (particles_.GetRy(i) + radius > high + EPSILON) {
+    particles_.SetRy(i, high - radius);
+  }
+}
+
+// Remembers a change, to undo it when rolling back. Changes of no particle
+// are given i = -1.
+void Domain::Log(Change::Type type, int i) {
+  Change change;
+  change.type = type;
+  change.time = time_;
+  change.i = i;
+  if (i != -1) {
+    change.id = ids_[i];
+    change.ghost = ghosts_[i];
+    change.cell = grid_.GetCell(i);
+    change.state = particles_.GetState(i);
+    change.radius = particles_.GetRadius(i);
+    change.mass = particles_.GetMass(i);
+    change.birthdate = particles_.GetBirthdate(i);
+  }
+  changes_.push_back(change);
+}
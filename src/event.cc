@@ -1,40 +1,23 @@
 // Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
 
+#include <vector>
+
 #include "include/event.h"
-#include "include/particle.h"
+
+constexpr int Event::kNone;
 
 // Initializes a new event to occur at time t, involving particles a and b
-Event::Event(Event::Type type, double t, Particle* a, Particle* b) :
-    type_ {type}, time_ {t}, a_ {a}, b_ {b},
-    collisions_count_a_ {0}, collisions_count_b_ {0} {
-  if (a != nullptr) {
-    collisions_count_a_ = a->Count();
-  } else {
-    collisions_count_a_ = -1;
-  }
-
-  if (b != nullptr) {
-    collisions_count_b_ = b->Count();
-  } else {
-    collisions_count_b_ = -1;
-  }
-}
+Event::Event(Event::Type type, double t, int a, int b, int count_b) :
+    time_ {t}, a_ {a}, b_ {b}, count_b_ {count_b}, type_ {type} {}
 
 // > operator for the piority queue
 bool Event::operator>(const Event& rhs) const {
   return time_ > rhs.time_;
 }
 
-// Has any collision occurred between when event was created and now?
-bool Event::IsValid() const {
-  if (a_ != nullptr && a_->Count() != collisions_count_a_) {
-    return false;
-  }
-  if (b_ != nullptr && b_->Count() != collisions_count_b_) {
-    return false;
-  }
-
-  return true;
+// Has particle b collided since the event was created?
+bool Event::IsValid(const std::vector<int>& counts) const {
+  return b_ == kNone || counts[b_] == count_b_;
 }
 
 // Returns the time that event is scheduled to occur
@@ -42,13 +25,13 @@ double Event::GetTime() const {
   return time_;
 }
 
-// Returns particle A
-Particle* Event::GetParticleA() const {
+// Returns the index of particle A
+int Event::GetParticleA() const {
   return a_;
 }
 
-// Returns particle B
-Particle* Event::GetParticleB() const {
+// Returns the index of particle B
+int Event::GetParticleB() const {
   return b_;
 }
 
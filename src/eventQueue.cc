@@ -0,0 +1,31 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "include/eventQueue.h"
+#include "include/heapQueue.h"
+#include "include/calendarQueue.h"
+
+// Returns an empty queue of the specified type.
+std::unique_ptr<EventQueue> EventQueue::Create(Type type) {
+  switch (type) {
+    case Type::kCalendar:
+      return std::unique_ptr<EventQueue>(new CalendarQueue());
+    case Type::kHeap:
+    default:
+      return std::unique_ptr<EventQueue>(new HeapQueue());
+  }
+}
+
+// Empty virtual destructor.
+EventQueue::~EventQueue() {}
+
+// Replaces every event with the specified events, given with their slots.
+void EventQueue::Assign(const std::vector<std::pair<int, Event>>& events) {
+  Clear();
+  for (const auto& event : events) {
+    Update(event.first, event.second);
+  }
+}
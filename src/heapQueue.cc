@@ -0,0 +1,157 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <utility>
+#include <vector>
+
+#include "include/heapQueue.h"
+#include "include/event.h"
+
+// Initializes an empty queue.
+HeapQueue::HeapQueue() {}
+
+// Stores the event in the specified slot, replacing the previous one.
+void HeapQueue::Update(int slot, const Event& event) {
+  if (slot >= static_cast<int>(positions_.size())) {
+    positions_.resize(slot + 1, -1);
+  }
+
+  if (positions_[slot] == -1) {
+    positions_[slot] = events_.size();
+    events_.push_back(event);
+    slots_.push_back(slot);
+    SiftUp(events_.size() - 1);
+  } else {
+    std::size_t i = positions_[slot];
+    bool earlier {EventQueue::IsLater(events_[i], slot, event, slot)};
+    events_[i] = event;
+    if (earlier) {
+      SiftUp(i);
+    } else {
+      SiftDown(i);
+    }
+  }
+}
+
+// Removes the event of the specified slot, if any.
+void HeapQueue::Remove(int slot) {
+  if (!Contains(slot)) {
+    return;
+  }
+
+  std::size_t i = positions_[slot];
+  std::size_t last {events_.size() - 1};
+  if (i != last) {
+    Swap(i, last);
+  }
+  events_.pop_back();
+  slots_.pop_back();
+  positions_[slot] = -1;
+
+  if (i != last) {
+    SiftUp(i);
+    SiftDown(i);
+  }
+}
+
+// Returns whether the specified slot holds an event.
+bool HeapQueue::Contains(int slot) const {
+  return slot < static_cast<int>(positions_.size()) && positions_[slot] != -1;
+}
+
+// Returns the event of the specified slot.
+const Event& HeapQueue::Get(int slot) const {
+  return events_[positions_[slot]];
+}
+
+// Returns the earliest event.
+const Event& HeapQueue::Top() const {
+  return events_.front();
+}
+
+// Returns the slot of the earliest event.
+int HeapQueue::TopSlot() const {
+  return slots_.front();
+}
+
+// Returns whether the queue is empty.
+bool HeapQueue::Empty() const {
+  return events_.empty();
+}
+
+// Returns the number of events in the queue.
+std::size_t HeapQueue::Size() const {
+  return events_.size();
+}
+
+// Removes every event.
+void HeapQueue::Clear() {
+  events_.clear();
+  slots_.clear();
+  positions_.assign(positions_.size(), -1);
+}
+
+// Replaces every event with the specified events, given with their slots.
+// The heap is built bottom-up, in O(n).
+void HeapQueue::Assign(const std::vector<std::pair<int, Event>>& events) {
+  Clear();
+  events_.reserve(events.size());
+  slots_.reserve(events.size());
+  for (const auto& event : events) {
+    if (event.first >= static_cast<int>(positions_.size())) {
+      positions_.resize(event.first + 1, -1);
+    }
+    positions_[event.first] = events_.size();
+    events_.push_back(event.second);
+    slots_.push_back(event.first);
+  }
+
+  for (std::size_t i {events_.size() / 2}; i > 0; --i) {
+    SiftDown(i - 1);
+  }
+}
+
+// Moves the entry at heap position i up until the heap is ordered.
+void HeapQueue::SiftUp(std::size_t i) {
+  while (i > 0) {
+    std::size_t parent {(i - 1) / 2};
+    if (!IsLater(parent, i)) {
+      break;
+    }
+    Swap(i, parent);
+    i = parent;
+  }
+}
+
+// Moves the entry at heap position i down until the heap is ordered.
+void HeapQueue::SiftDown(std::size_t i) {
+  std::size_t size {events_.size()};
+  for (;;) {
+    std::size_t smallest {i};
+    std::size_t left {2 * i + 1}, right {2 * i + 2};
+    if (left < size && IsLater(smallest, left)) {
+      smallest = left;
+    }
+    if (right < size && IsLater(smallest, right)) {
+      smallest = right;
+    }
+    if (smallest == i) {
+      break;
+    }
+    Swap(i, smallest);
+    i = smallest;
+  }
+}
+
+// Returns whether the entry at heap position i comes after the entry at heap
+// position j.
+bool HeapQueue::IsLater(std::size_t i, std::size_t j) const {
+  return EventQueue::IsLater(events_[i], slots_[i], events_[j], slots_[j]);
+}
+
+// Swaps the entries at heap positions i and j.
+void HeapQueue::Swap(std::size_t i, std::size_t j) {
+  std::swap(events_[i], events_[j]);
+  std::swap(slots_[i], slots_[j]);
+  positions_[slots_[i]] = i;
+  positions_[slots_[j]] = j;
+}
@@ -0,0 +1,185 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "include/isosurface.h"
+#include "include/snapshot.h"
+#include "include/threadPool.h"
+#include "include/hsv2rgb.h"
+#include "include/cpu.h"
+
+#ifdef MDSIM_AVX2
+#include <immintrin.h>
+#endif
+
+// Weight of the kernel: a particle adds kKernelWeight times its radius over
+// the distance to a pixel, in degrees of hue.
+static constexpr float kKernelWeight {300.0f};
+
+// Distance the kernel of a particle is cut off at, in radii. The kernel goes
+// smoothly to 0 there, so that no edge shows.
+static constexpr double kCutoff {8.0};
+
+// Smallest square distance from a pixel to a center: keeps the kernel
+// finite.
+static constexpr float kMinSquareDistance {0.25f};
+
+// Largest hue, in degrees: denser pixels saturate. Below 360, whose red is
+// the one of empty pixels.
+static constexpr int kMaxHue {300};
+
+#ifdef MDSIM_AVX2
+// Adds count values of a row of a kernel to a row of the density, eight at
+// a time, and returns the number of values done.
+__attribute__((target("avx2")))
+static int AddRowAvx2(float* density, const float* kernel, int count) {
+  int batches {count / 8};
+  for (int batch {0}; batch < batches; ++batch) {
+    int k {8 * batch};
+    _mm256_storeu_ps(density + k, _mm256_add_ps(_mm256_loadu_ps(density + k),
+        _mm256_loadu_ps(kernel + k)));
+  }
+  return 8 * batches;
+}
+#endif
+
+// Initializes a renderer of images of width x height pixels, the top left
+// one at (left, top) in the simulation box, rendered on the specified number
+// of threads.
+IsosurfaceRenderer::IsosurfaceRenderer(int width, int height, double left,
+    double top, int threads) :
+    width_ {width}, height_ {height},
+    left_ {left}, top_ {top},
+    pool_ {new ThreadPool(threads)},
+    density_(static_cast<std::size_t>(width) * height),
+    pixels_(4 * density_.size()),
+    colors_(4 * (kMaxHue + 1)) {
+  for (int hue {0}; hue <= kMaxHue; ++hue) {
+    float r {0}, g {0}, b {0};
+    HSVtoRGB(hue, 1.0, 1.0, &r, &g, &b);
+    colors_[4 * hue] = r * 255;
+    colors_[4 * hue + 1] = g * 255;
+    colors_[4 * hue + 2] = b * 255;
+    colors_[4 * hue + 3] = 255;
+  }
+}
+
+// Renders the particles of the specified snapshot, and returns the pixels.
+// Particles are sorted by row, so that each band of rows finds the
+// particles reaching it by bisection.
+const std::vector<uint8_t>& IsosurfaceRenderer::Render(
+    const Snapshot& snapshot) {
+  order_.clear();
+  for (std::size_t i {0}; i < snapshot.rx.size(); ++i) {
+    order_.push_back(i);
+  }
+  std::sort(order_.begin(), order_.end(), [&snapshot](int a, int b) {
+    return snapshot.ry[a] < snapshot.ry[b];
+  });
+
+  rows_.clear();
+  kernel_of_.clear();
+  int reach {0};
+  for (int i : order_) {
+    rows_.push_back(snapshot.ry[i] - top_);
+    kernel_of_.push_back(FindKernel(snapshot.radius[i]));
+    reach = std::max(reach, kernels_[kernel_of_.back()].reach);
+  }
+
+  pool_->ParallelFor(height_, [this, &snapshot, reach](std::size_t begin,
+      std::size_t end, int) {
+    float* density {density_.data() + begin * width_};
+    std::fill(density, density_.data() + end * width_, 0.0f);
+
+    // Particles whose pixel may be within reach of the band
+    std::size_t first = std::lower_bound(rows_.begin(), rows_.end(),
+        static_cast<double>(begin) - reach - 1.0) - rows_.begin();
+    std::size_t last = std::upper_bound(rows_.begin(), rows_.end(),
+        static_cast<double>(end) + reach + 1.0) - rows_.begin();
+    for (std::size_t k {first}; k < last; ++k) {
+      int i {order_[k]};
+      Splat(kernels_[kernel_of_[k]], snapshot.rx[i], snapshot.ry[i],
+          begin, end);
+    }
+
+    uint8_t* pixel {pixels_.data() + 4 * begin * width_};
+    for (float* value {density}; value != density_.data() + end * width_;
+        ++value, pixel += 4) {
+      int hue {static_cast<int>(std::min(*value, float {kMaxHue}))};
+      std::copy(&colors_[4 * hue], &colors_[4 * hue] + 4, pixel);
+    }
+  });
+  return pixels_;
+}
+
+// Returns the width of the images, in pixels.
+int IsosurfaceRenderer::GetWidth() const {
+  return width_;
+}
+
+// Returns the height of the images, in pixels.
+int IsosurfaceRenderer::GetHeight() const {
+  return height_;
+}
+
+// Returns the index of the kernel of particles of the specified radius,
+// computed when first needed.
+int IsosurfaceRenderer::FindKernel(double radius) {
+  for (std::size_t k {0}; k < kernels_.size(); ++k) {
+    if (kernels_[k].radius == radius) {
+      return k;
+    }
+  }
+
+  Kernel kernel;
+  kernel.radius = radius;
+  double cutoff {kCutoff * radius};
+  kernel.reach = static_cast<int>(std::floor(cutoff));
+  int side {2 * kernel.reach + 1};
+  kernel.values.resize(side * side);
+  for (int y {0}; y < side; ++y) {
+    for (int x {0}; x < side; ++x) {
+      double dx {static_cast<double>(x - kernel.reach)};
+      double dy {static_cast<double>(y - kernel.reach)};
+      double d2 {std::max(dx * dx + dy * dy, double {kMinSquareDistance})};
+      kernel.values[y * side + x] = std::max(kKernelWeight * radius
+          * (1.0 / std::sqrt(d2) - 1.0 / cutoff), 0.0);
+    }
+  }
+  kernels_.push_back(kernel);
+  return kernels_.size() - 1;
+}
+
+// Adds the specified kernel to the rows [begin, end) of the density,
+// centered on the pixel of position (x, y) in the simulation box.
+void IsosurfaceRenderer::Splat(const Kernel& kernel, double x, double y,
+    int begin, int end) {
+  int reach {kernel.reach};
+  int side {2 * reach + 1};
+  int column {static_cast<int>(std::floor(x - left_ + 0.5))};
+  int row {static_cast<int>(std::floor(y - top_ + 0.5))};
+
+  int first_row {std::max(begin, row - reach)};
+  int last_row {std::min(end - 1, row + reach)};
+  int first {std::max(0, column - reach)};
+  int last {std::min(width_ - 1, column + reach)};
+  int count {last - first + 1};
+  for (int r {first_row}; r <= last_row; ++r) {
+    float* density {density_.data() + r * width_ + first};
+    const float* values {kernel.values.data()
+        + (r - row + reach) * side + first - column + reach};
+    int k {0};
+    if (HasAvx2()) {
+#ifdef MDSIM_AVX2
+      k = AddRowAvx2(density, values, count);
+#endif
+    }
+    for (; k < count; ++k) {
+      density[k] += values[k];
+    }
+  }
+}
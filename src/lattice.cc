@@ -0,0 +1,45 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <random>
+#include <vector>
+
+#include "include/main.h"
+#include "include/lattice.h"
+#include "include/particle.h"
+
+// Returns whether particles of the specified radius, the specified space
+// apart, make a square crystal.
+bool IsLatticeValid(double radius, double spacing) {
+  return radius >= 0 && 2 * radius + spacing > 0;
+}
+
+// Returns particles of the specified radius and unit mass filling the
+// simulation box in a simple square crystal, the specified space apart, with
+// random velocities drawn from the specified seed. Invalid crystals would
+// fill the memory with particles at the same place: they have none.
+std::vector<Particle> MakeSquareLattice(double radius, double spacing,
+    unsigned int seed) {
+  std::mt19937 rng {seed};
+  std::uniform_real_distribution<double> random_speed(-1, 1);
+
+  std::vector<Particle> particles {};
+  if (!IsLatticeValid(radius, spacing)) {
+    return particles;
+  }
+  double x {(WINDOW_SIZE - BOX_SIZE) / 2 + radius}, y {0};
+  while (x + radius < (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE) {
+    y = (WINDOW_SIZE - BOX_SIZE) / 2 + radius;
+    while (y + radius < (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE) {
+      // Draw the velocity components in a set order, for reproducibility
+      double vx {random_speed(rng)};
+      double vy {random_speed(rng)};
+      particles.push_back(Particle(0, x, y, vx, vy, radius, 1));
+
+      y += 2 * radius + spacing;
+    }
+
+    x += 2 * radius + spacing;
+  }
+
+  return particles;
+}
@@ -1,72 +1,407 @@
 // Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
 
+#include <chrono>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <memory>
 #include <random>
 #include <sstream>
-#include <SFML/Graphics.hpp>
+#include <string>
+#include <vector>
 
 #include "include/main.h"
 #include "include/particle.h"
+#include "include/lattice.h"
 #include "include/collisionSystem.h"
+#include "include/parallelSystem.h"
+#include "include/eventQueue.h"
+#include "include/overlaps.h"
+#include "include/trajectory.h"
+#include "include/serializer.h"
+#include "include/checkpoint.h"
+#include "include/stats.h"
+#ifndef MDSIM_HEADLESS
+#include "include/viewer.h"
+#endif
+
+// Parses a number from a command line argument.
+template <typename T>
+static bool ParseArgument(const char* argument, T* value) {
+  std::istringstream ss {argument};
+  if (!(ss >> *value)) {
+    std::cerr << "Invalid number " << argument << '\n';
+    return false;
+  }
+  return true;
+}
+
+// Returns the particles of a simple square crystal, with random velocities
+// drawn from the specified seed, or from a random one.
+static std::vector<Particle> MakeParticles(int radius, int spacing,
+    bool seeded, unsigned int seed) {
+  if (!seeded) {
+    seed = std::random_device()();
+  }
+  std::vector<Particle> particles {MakeSquareLattice(radius, spacing, seed)};
+
+  // Overlapping particles would go through each other
+  std::size_t overlaps_count {FindOverlaps(particles).size()};
+  if (overlaps_count > 0) {
+    printf("Warning: %zu pairs of particles overlap.\n", overlaps_count);
+  }
+  return particles;
+}
+
+// Hands the state of the system over to the checkpoint writer.
+static void SaveCheckpoint(const CollisionSystem& system,
+    CheckpointWriter* checkpoints) {
+  std::vector<char> state;
+  Serializer out {&state};
+  system.Save(&out);
+  checkpoints->Write(&state);
+}
+
+// Runs the system up to time duration, or for the specified number of events
+// if not negative, one event at a time. Writes a trajectory frame at each
+// redraw event, or at each multiple of interval if positive, a checkpoint at
+// each multiple of checkpoint_interval if positive, and a line of stats at
+// each multiple of stats_interval, and both at the end. Any writer may be
+// nullptr. Checkpoints and stats leave the run unchanged, so that a run
+// restarted from a checkpoint goes on exactly as this one.
+static void RunBatch(CollisionSystem* system, double duration, long events,
+    double interval, TrajectoryWriter* writer, double checkpoint_interval,
+    CheckpointWriter* checkpoints, double stats_interval, FILE* stats) {
+  long frame {0}, checkpoint {0}, stats_line {0};
+  if (interval > 0) {
+    frame = static_cast<long>(std::ceil(system->GetTime() / interval));
+  }
+  if (checkpoint_interval > 0) {
+    checkpoint = static_cast<long>(
+        std::floor(system->GetTime() / checkpoint_interval)) + 1;
+  }
+  if (stats_interval > 0) {
+    stats_line = static_cast<long>(
+        std::floor(system->GetTime() / stats_interval)) + 1;
+  }
+
+  for (long n {0}; events < 0 || n < events; ++n) {
+    double t {system->GetNextEventTime()};
+
+    // Frames before the next event: nothing moves in between
+    while (writer != nullptr && interval > 0 && frame * interval < t
+        && (events >= 0 || frame * interval <= duration)) {
+      system->RunUntil(frame * interval);
+      writer->Write(system->GetTime(), system->GetParticles());
+      frame++;
+    }
+
+    // Checkpoint due before the next event
+    if (checkpoints != nullptr && checkpoint_interval > 0
+        && checkpoint * checkpoint_interval < t
+        && (events >= 0 || checkpoint * checkpoint_interval <= duration)) {
+      SaveCheckpoint(*system, checkpoints);
+      checkpoint = static_cast<long>(std::ceil(t / checkpoint_interval));
+    }
+
+    // Stats due before the next event
+    if (stats != nullptr && stats_interval > 0
+        && stats_line * stats_interval < t
+        && (events >= 0 || stats_line * stats_interval < duration)) {
+      WriteStats(stats, system->GetTime(), system->GetStats());
+      stats_line = static_cast<long>(std::ceil(t / stats_interval));
+    }
+
+    if (events < 0 && t > duration) {
+      break;
+    }
+    if (system->Step().GetType() == Event::Type::kRedraw
+        && writer != nullptr && interval <= 0) {
+      writer->Write(system->GetTime(), system->GetParticles());
+    }
+  }
+
+  if (checkpoints != nullptr) {
+    SaveCheckpoint(*system, checkpoints);
+  }
+  if (events < 0) {
+    system->RunUntil(duration);
+  }
+  if (stats != nullptr) {
+    WriteStats(stats, system->GetTime(), system->GetStats());
+  }
+}
 
 int main(int argc, char* argv[]) {
-  if (argc != 4) {
+  // A restarted run takes its particles and friction from a checkpoint,
+  // instead of the first arguments
+  std::string restart {};
+  int first_option {4};
+  if (argc >= 3 && std::string(argv[1]) == "--restart") {
+    restart = argv[2];
+    first_option = 3;
+  } else if (argc < 4) {
     printf("Please enter the particle radius, the space between the "
-    "particles and the friction.\n");
+    "particles and the friction.\n"
+    "Options: --batch (run without window), --time T (batch duration), "
+    "--events N (batch event count), --scheduler heap|calendar, "
+    "--domains N (batch run split into N domains simulated in parallel), "
+    "--seed S (random velocities drawn from seed S), "
+    "--trajectory path (batch run written to a trajectory file), "
+    "--interval T (a trajectory frame every T instead of every redraw), "
+    "--checkpoint path (batch run saved to a checkpoint at the end), "
+    "--checkpoint-interval T (and every T), "
+    "--stats path (batch run counters written as JSON lines at the end), "
+    "--stats-interval T (and every T, 10 by default).\n"
+    "Restart from a checkpoint with: --restart path [options].\n");
     return 1;
   }
 
   int particle_radius {0};
-  std::istringstream ss1 {argv[1]};
-  if (!(ss1 >> particle_radius)) {
-    std::cerr << "Invalid number " << argv[1] << '\n';
+  int space_between_particles {0};
+  double friction {0.0};
+  if (restart.empty() && (!ParseArgument(argv[1], &particle_radius)
+      || !ParseArgument(argv[2], &space_between_particles)
+      || !ParseArgument(argv[3], &friction))) {
     return 1;
   }
-
-  int space_between_particles {0};
-  std::istringstream ss2 {argv[2]};
-  if (!(ss2 >> space_between_particles)) {
-    std::cerr << "Invalid number " << argv[2] << '\n';
+  if (restart.empty()
+      && !IsLatticeValid(particle_radius, space_between_particles)) {
+    std::cerr << "Invalid crystal: radius " << particle_radius
+        << ", spacing " << space_between_particles << '\n';
     return 1;
   }
 
-  double friction {0.0};
-  std::istringstream ss3 {argv[3]};
-  if (!(ss3 >> friction)) {
-    std::cerr << "Invalid number " << argv[3] << '\n';
+  // Batch mode: the simulation runs without any window, either for a given
+  // simulation time or for a given number of events
+#ifdef MDSIM_HEADLESS
+  bool batch {true};
+#else
+  bool batch {false};
+#endif
+  double duration {100.0};
+  long events {-1};
+  EventQueue::Type scheduler {EventQueue::Type::kHeap};
+  int domains {0};
+  unsigned int seed {0};
+  bool seeded {false};
+  std::string trajectory {};
+  double interval {0.0};
+  std::string checkpoint {};
+  double checkpoint_interval {0.0};
+  std::string stats_path {};
+  double stats_interval {10.0};
+  for (int i {first_option}; i < argc; ++i) {
+    std::string option {argv[i]};
+    if (option == "--batch") {
+      batch = true;
+    } else if (option == "--time" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &duration)) {
+        return 1;
+      }
+    } else if (option == "--events" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &events)) {
+        return 1;
+      }
+    } else if (option == "--scheduler" && i + 1 < argc) {
+      std::string name {argv[++i]};
+      if (name == "heap") {
+        scheduler = EventQueue::Type::kHeap;
+      } else if (name == "calendar") {
+        scheduler = EventQueue::Type::kCalendar;
+      } else {
+        std::cerr << "Invalid scheduler " << name << '\n';
+        return 1;
+      }
+    } else if (option == "--domains" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &domains)) {
+        return 1;
+      }
+    } else if (option == "--seed" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &seed)) {
+        return 1;
+      }
+      seeded = true;
+    } else if (option == "--trajectory" && i + 1 < argc) {
+      trajectory = argv[++i];
+    } else if (option == "--interval" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &interval)) {
+        return 1;
+      }
+    } else if (option == "--checkpoint" && i + 1 < argc) {
+      checkpoint = argv[++i];
+    } else if (option == "--checkpoint-interval" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &checkpoint_interval)) {
+        return 1;
+      }
+    } else if (option == "--stats" && i + 1 < argc) {
+      stats_path = argv[++i];
+    } else if (option == "--stats-interval" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &stats_interval)) {
+        return 1;
+      }
+    } else {
+      std::cerr << "Invalid option " << option << '\n';
+      return 1;
+    }
+  }
+
+  // Trajectory and checkpoints of batch runs, written on threads of their
+  // own
+  if (!trajectory.empty() && !batch) {
+    std::cerr << "--trajectory needs --batch\n";
+    return 1;
+  }
+  if (!checkpoint.empty() && (!batch || domains > 0)) {
+    std::cerr << "--checkpoint needs --batch, without --domains\n";
+    return 1;
+  }
+  if (!stats_path.empty() && (!batch || domains > 0)) {
+    std::cerr << "--stats needs --batch, without --domains\n";
+    return 1;
+  }
+  if (!restart.empty() && domains > 0) {
+    std::cerr << "--restart does not support --domains\n";
+    return 1;
+  }
+  CheckpointWriter checkpoints;
+  if (!checkpoint.empty()) {
+    checkpoints.Open(checkpoint);
+  }
+  TrajectoryWriter writer;
+  if (!trajectory.empty() && !writer.Open(trajectory, BOX_SIZE)) {
+    std::cerr << "Cannot create " << trajectory << '\n';
     return 1;
   }
 
-  std::mt19937 rng {std::random_device()()};
-  std::uniform_real_distribution<double> random_speed(-1, 1);
+  // Parallel engine: batch runs for a given simulation time only
+  if (domains > 0) {
+    if (!batch || events >= 0) {
+      std::cerr << "--domains needs --batch and --time\n";
+      return 1;
+    }
+    if (!trajectory.empty() && interval <= 0) {
+      std::cerr << "--domains needs --interval with --trajectory\n";
+      return 1;
+    }
 
-  // Initialization of the particles collection
-  std::vector<Particle> particles {};
+    auto start {std::chrono::steady_clock::now()};
+    ParallelSystem system {MakeParticles(particle_radius,
+        space_between_particles, seeded, seed), friction, domains, scheduler};
+    if (!trajectory.empty()) {
+      long frames {static_cast<long>(std::floor(duration / interval))};
+      for (long frame {0}; frame <= frames; ++frame) {
+        system.RunUntil(frame * interval);
+        writer.Write(system.GetTime(), system.GetParticles());
+      }
+    }
+    system.RunUntil(duration);
+    std::chrono::duration<double> elapsed {
+        std::chrono::steady_clock::now() - start};
+    writer.Close();
 
-  // particles.push_back(Particle(0, 400, 500, 0, 0, particle_radius, 1, sf::Color::Red));
+    printf("Particles count: %zu\n", system.GetParticles().Count());
+    printf("Domains: %d\n", system.GetDomains());
+    printf("Time: %f\n", system.GetTime());
+    printf("Collisions: %ld\n", system.GetCollisions());
+    printf("Rollbacks: %ld\n", system.GetRollbacks());
+    printf("Av. kinetic energy: %gJ\n", system.GetAverageKineticEnergy());
+    printf("Collisions per second: %.0f\n",
+        system.GetCollisions() / elapsed.count());
+    if (!trajectory.empty()) {
+      printf("Trajectory frames: %ld (%ld dropped)\n", writer.GetFrames(),
+          writer.GetDroppedFrames());
+      if (writer.HasFailed()) {
+        std::cerr << "Cannot write trajectory " << trajectory << '\n';
+        return 1;
+      }
+    }
+    return 0;
+  }
 
-  // Initialize particles in a simple square crystal.
-  double x {(WINDOW_SIZE - BOX_SIZE) / 2 + particle_radius}, y {0};
-  while (x + particle_radius < (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE) {
-    y = (WINDOW_SIZE - BOX_SIZE) / 2 + particle_radius;
-    while (y + particle_radius < (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE) {
-      particles.push_back(Particle(0, x, y,
-          random_speed(rng), random_speed(rng),
-          particle_radius,
-          1,
-          sf::Color::Red));
+  // Initialization of the collision system, or its restoration
+  std::unique_ptr<CollisionSystem> system {};
+  if (restart.empty()) {
+    system.reset(new CollisionSystem(MakeParticles(particle_radius,
+        space_between_particles, seeded, seed), friction, scheduler));
+  } else {
+    std::vector<char> state;
+    if (!ReadCheckpoint(restart, &state)) {
+      std::cerr << "Cannot read checkpoint " << restart << '\n';
+      return 1;
+    }
+    Deserializer in {state.data(), state.size()};
+    system = CollisionSystem::Restore(&in, scheduler);
+    if (!system) {
+      std::cerr << "Invalid checkpoint " << restart << '\n';
+      return 1;
+    }
+  }
 
-      y += 2 * particle_radius + space_between_particles;
+  if (batch) {
+    FILE* stats {nullptr};
+    if (!stats_path.empty()) {
+      stats = fopen(stats_path.c_str(), "w");
+      if (stats == nullptr) {
+        std::cerr << "Cannot create " << stats_path << '\n';
+        return 1;
+      }
     }
 
-    x += 2 * particle_radius + space_between_particles;
-  }
+    auto start {std::chrono::steady_clock::now()};
+    if (!trajectory.empty() || !checkpoint.empty() || stats != nullptr) {
+      RunBatch(system.get(), duration, events, interval,
+          trajectory.empty() ? nullptr : &writer, checkpoint_interval,
+          checkpoint.empty() ? nullptr : &checkpoints, stats_interval, stats);
+    } else if (events >= 0) {
+      system->RunEvents(events);
+    } else {
+      system->RunUntil(duration);
+    }
+    std::chrono::duration<double> elapsed {
+        std::chrono::steady_clock::now() - start};
+    writer.Close();
+    checkpoints.Close();
+    if (stats != nullptr) {
+      fclose(stats);
+    }
 
-  // Initialization of the collision system
-  CollisionSystem system {particles, friction};
+    Stats counters {system->GetStats()};
+    printf("Particles count: %zu\n", system->GetParticles().Count());
+    printf("Time: %f\n", system->GetTime());
+    printf("Collisions: %ld\n", system->GetCollisions());
+    printf("Av. kinetic energy: %gJ\n", system->GetAverageKineticEnergy());
+    printf("Collisions per second: %.0f\n",
+        system->GetCollisions() / elapsed.count());
+    printf("Events: %ld, invalid events popped: %ld\n", counters.GetEvents(),
+        counters.invalid_events);
+    printf("Queue high-water mark: %zu\n", counters.queue_high_water);
+    printf("Overlaps: %ld\n", counters.overlaps);
+    printf("Predict time: %fs, advance time: %fs\n",
+        counters.predict_seconds, counters.advance_seconds);
+    if (!trajectory.empty()) {
+      printf("Trajectory frames: %ld (%ld dropped)\n", writer.GetFrames(),
+          writer.GetDroppedFrames());
+      if (writer.HasFailed()) {
+        std::cerr << "Cannot write trajectory " << trajectory << '\n';
+        return 1;
+      }
+    }
+    if (!checkpoint.empty()) {
+      printf("Checkpoints: %ld\n", checkpoints.GetCheckpoints());
+      if (checkpoints.HasFailed()) {
+        std::cerr << "Cannot write checkpoint " << checkpoint << '\n';
+        return 1;
+      }
+    }
+    return 0;
+  }
 
+#ifndef MDSIM_HEADLESS
   // Initialization of the simulation
-  system.Simulate();
+  Viewer viewer {system.get()};
+  viewer.Run();
+#endif
 
   return 0;
 }
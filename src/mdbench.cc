@@ -0,0 +1,357 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/main.h"
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/event.h"
+#include "include/eventQueue.h"
+#include "include/collisionSystem.h"
+#include "include/lattice.h"
+#include "include/isosurface.h"
+#include "include/snapshot.h"
+
+// Flags the benchmarks were built with, see the Makefile.
+#ifndef MDBENCH_FLAGS
+#define MDBENCH_FLAGS "unknown"
+#endif
+
+// Whether the compiler optimized the benchmarks.
+#ifdef __OPTIMIZE__
+static constexpr bool kOptimized {true};
+#else
+static constexpr bool kOptimized {false};
+#endif
+
+// Seed of every random draw: runs of the same version are comparable.
+static constexpr unsigned int kSeed {42};
+
+// Number of particle pairs of the microbenchmarks.
+static constexpr int kPairs {4096};
+
+// Minimum duration of a microbenchmark measurement, in seconds.
+static constexpr double kMinSeconds {0.2};
+
+// Sink of the values computed, so that the compiler keeps computing them.
+static volatile double sink {0.0};
+
+// Result of a microbenchmark.
+struct Benchmark {
+  std::string name;
+  long iterations;
+  double nanoseconds;
+};
+
+// Result of an end-to-end scenario.
+struct Scenario {
+  std::size_t particles;
+  double packing_fraction;
+  std::string scheduler;
+  double setup_seconds;
+  long events;
+  double seconds;
+};
+
+// Parses a number from a command line argument.
+template <typename T>
+static bool ParseArgument(const char* argument, T* value) {
+  std::istringstream ss {argument};
+  if (!(ss >> *value)) {
+    std::cerr << "Invalid number " << argument << '\n';
+    return false;
+  }
+  return true;
+}
+
+// Returns the seconds elapsed since start.
+static double Since(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed {
+      std::chrono::steady_clock::now() - start};
+  return elapsed.count();
+}
+
+// Runs the operation, given the number of iterations to run, with more and
+// more iterations until they take kMinSeconds, and returns the time per
+// iteration.
+static Benchmark Measure(const std::string& name,
+    const std::function<void(long iterations)>& operation) {
+  long iterations {1};
+  for (;;) {
+    auto start {std::chrono::steady_clock::now()};
+    operation(iterations);
+    double seconds {Since(start)};
+    if (seconds >= kMinSeconds) {
+      return Benchmark {name, iterations, 1e9 * seconds / iterations};
+    }
+    iterations *= seconds > 0.01 ? 2 * kMinSeconds / seconds : 10;
+  }
+}
+
+// Runs the microbenchmarks of the hot paths of the engine.
+static std::vector<Benchmark> RunMicrobenchmarks() {
+  std::vector<Benchmark> benchmarks;
+
+  // Particles of a crystal at a moderate packing fraction: they do not
+  // overlap
+  ParticleStore particles;
+  for (const auto& particle : MakeSquareLattice(4, 4, kSeed)) {
+    particles.Add(particle);
+  }
+  int count {static_cast<int>(particles.Size())};
+
+  // Random pairs of particles, read as groups of 9 candidates too
+  std::mt19937 rng {kSeed};
+  std::uniform_int_distribution<int> index(0, count - 1);
+  std::vector<int> pairs(2 * kPairs);
+  for (auto& i : pairs) {
+    i = index(rng);
+  }
+
+  benchmarks.push_back(Measure("TimeToHit",
+      [&particles, &pairs](long iterations) {
+        double sum {0.0};
+        for (long k {0}; k < iterations; ++k) {
+          std::size_t p {static_cast<std::size_t>(2 * (k % kPairs))};
+          sum += particles.TimeToHit(pairs[p], pairs[p + 1]);
+        }
+        sink = sum;
+      }));
+
+  benchmarks.push_back(Measure("TimeToHit/9 candidates",
+      [&particles, &pairs](long iterations) {
+        double times[9];
+        long sum {0};
+        for (long k {0}; k < iterations; ++k) {
+          std::size_t p {static_cast<std::size_t>(k % (2 * kPairs - 9))};
+          sum += particles.TimeToHit(pairs[p], &pairs[p], 9, times);
+        }
+        sink = sum;
+      }));
+
+  benchmarks.push_back(Measure("TimeToHitVerticalWall",
+      [&particles, count](long iterations) {
+        double sum {0.0};
+        for (long k {0}; k < iterations; ++k) {
+          sum += particles.TimeToHitVerticalWall(k % count, BOX_SIZE,
+              0.0);
+        }
+        sink = sum;
+      }));
+
+  benchmarks.push_back(Measure("TimeToHitHorizontalWall",
+      [&particles, count](long iterations) {
+        double sum {0.0};
+        for (long k {0}; k < iterations; ++k) {
+          sum += particles.TimeToHitHorizontalWall(k % count, BOX_SIZE,
+              0.0);
+        }
+        sink = sum;
+      }));
+
+  benchmarks.push_back(Measure("BounceOff",
+      [&particles, &pairs](long iterations) {
+        for (long k {0}; k < iterations; ++k) {
+          std::size_t p {static_cast<std::size_t>(2 * (k % kPairs))};
+          if (pairs[p] != pairs[p + 1]) {
+            particles.BounceOff(pairs[p], pairs[p + 1], 1.0);
+          }
+        }
+        sink = particles.GetVx(0);
+      }));
+
+  // Hold model: each iteration pops the earliest event, and pushes an event
+  // of the same slot a random time later
+  for (auto type : {EventQueue::Type::kHeap, EventQueue::Type::kCalendar}) {
+    std::string name {type == EventQueue::Type::kHeap ? "heap" : "calendar"};
+    benchmarks.push_back(Measure("Event push/pop/" + name,
+        [type](long iterations) {
+          std::mt19937 hold_rng {kSeed};
+          std::exponential_distribution<double> delay(1.0);
+          std::unique_ptr<EventQueue> queue {EventQueue::Create(type)};
+          for (int slot {0}; slot < 2 * kPairs; ++slot) {
+            queue->Update(slot, Event(Event::Type::kCellCrossing,
+                delay(hold_rng), slot / 2));
+          }
+          for (long k {0}; k < iterations; ++k) {
+            int slot {queue->TopSlot()};
+            double t {queue->Top().GetTime()};
+            queue->Update(slot, Event(Event::Type::kCellCrossing,
+                t + delay(hold_rng), slot / 2));
+          }
+          sink = queue->Top().GetTime();
+        }));
+  }
+
+  // Predictions in a system at a moderate packing fraction
+  CollisionSystem system {MakeSquareLattice(4, 4, kSeed), 1.0,
+      EventQueue::Type::kHeap, 1};
+  benchmarks.push_back(Measure("Predict",
+      [&system, count](long iterations) {
+        for (long k {0}; k < iterations; ++k) {
+          system.Predict(k % count);
+        }
+        sink = system.GetQueueSize();
+      }));
+
+  // Snapshots of the system, as front ends take them at each redraw
+  Snapshot snapshot;
+  benchmarks.push_back(Measure("Snapshot",
+      [&system, &snapshot](long iterations) {
+        for (long k {0}; k < iterations; ++k) {
+          snapshot.Take(system);
+        }
+        sink = snapshot.rx.size();
+      }));
+
+  // Isosurface images of the whole box, on one thread
+  int size {static_cast<int>(BOX_SIZE)};
+  double corner {(WINDOW_SIZE - BOX_SIZE) / 2};
+  IsosurfaceRenderer renderer {size, size, corner, corner, 1};
+  benchmarks.push_back(Measure("Isosurface",
+      [&renderer, &snapshot](long iterations) {
+        for (long k {0}; k < iterations; ++k) {
+          sink = renderer.Render(snapshot)[0];
+        }
+      }));
+
+  return benchmarks;
+}
+
+// Runs a square crystal of about the specified number of particles, covering
+// about the specified fraction of the box, for the specified number of
+// events, and returns how long it took.
+static Scenario RunScenario(std::size_t particles, double packing_fraction,
+    EventQueue::Type scheduler, long events) {
+  // Radius for the packing fraction, and spacing for a crystal of m rows of
+  // m particles
+  double radius {BOX_SIZE * std::sqrt(packing_fraction / (M_PI * particles))};
+  double rows {std::ceil(std::sqrt(static_cast<double>(particles)))};
+  double spacing {(BOX_SIZE - 2 * radius) / (rows - 0.5) - 2 * radius};
+
+  auto start {std::chrono::steady_clock::now()};
+  CollisionSystem system {MakeSquareLattice(radius, spacing, kSeed), 1.0,
+      scheduler, 1};
+  double setup_seconds {Since(start)};
+
+  start = std::chrono::steady_clock::now();
+  system.RunEvents(events);
+  double seconds {Since(start)};
+
+  double wall_size {system.GetWallSize()};
+  std::size_t count {system.GetParticles().Count()};
+  return Scenario {count, count * M_PI * radius * radius
+      / (wall_size * wall_size),
+      scheduler == EventQueue::Type::kHeap ? "heap" : "calendar",
+      setup_seconds, events, seconds};
+}
+
+int main(int argc, char* argv[]) {
+  // Largest system of the end-to-end scenarios, and events per particle
+  std::size_t max_particles {1000000};
+  double events_per_particle {4.0};
+  bool micro {true}, scenarios {true};
+  std::string output {};
+  for (int i {1}; i < argc; ++i) {
+    std::string option {argv[i]};
+    if (option == "--max-particles" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &max_particles)) {
+        return 1;
+      }
+    } else if (option == "--events-per-particle" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &events_per_particle)) {
+        return 1;
+      }
+    } else if (option == "--micro") {
+      scenarios = false;
+    } else if (option == "--scenarios") {
+      micro = false;
+    } else if (option == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      std::cerr << "Invalid option " << option << '\n'
+          << "Options: --max-particles N (largest scenario, 1000000 by "
+          "default), --events-per-particle E (4 by default), --micro "
+          "(microbenchmarks only), --scenarios (scenarios only), "
+          "--output path.\n";
+      return 1;
+    }
+  }
+
+  // Opened first: a bad path fails before any measurement
+  FILE* file {stdout};
+  if (!output.empty()) {
+    file = fopen(output.c_str(), "w");
+    if (file == nullptr) {
+      std::cerr << "Cannot open " << output << '\n';
+      return 1;
+    }
+  }
+
+  // Written as they complete, so that a run cut short keeps its results
+  fprintf(file, "{\n  \"seed\": %u,\n  \"build\": {\"flags\": \"%s\", "
+      "\"optimized\": %s, \"compiler\": \"%s\"},\n  \"microbenchmarks\": [",
+      kSeed, MDBENCH_FLAGS, kOptimized ? "true" : "false", __VERSION__);
+  fflush(file);
+  std::vector<Benchmark> benchmarks;
+  if (micro) {
+    benchmarks = RunMicrobenchmarks();
+  }
+  for (std::size_t k {0}; k < benchmarks.size(); ++k) {
+    fprintf(file, "%s\n    {\"name\": \"%s\", \"iterations\": %ld, "
+        "\"ns_per_op\": %.3f}", k > 0 ? "," : "", benchmarks[k].name.c_str(),
+        benchmarks[k].iterations, benchmarks[k].nanoseconds);
+  }
+  fprintf(file, "%s],\n  \"scenarios\": [", benchmarks.empty() ? "" : "\n  ");
+  fflush(file);
+
+  // From dilute to dense, near the close packing of the square crystal
+  long scenarios_written {0};
+  if (scenarios) {
+    for (std::size_t particles {1000}; particles <= max_particles;
+        particles *= 10) {
+      for (double packing_fraction : {0.05, 0.2, 0.4, 0.6, 0.7}) {
+        for (auto type : {EventQueue::Type::kHeap,
+            EventQueue::Type::kCalendar}) {
+          long events {static_cast<long>(events_per_particle * particles)};
+          Scenario scenario {RunScenario(particles, packing_fraction, type,
+              events)};
+          fprintf(file, "%s\n    {\"particles\": %zu, "
+              "\"packing_fraction\": %.4f, \"scheduler\": \"%s\", "
+              "\"setup_seconds\": %.6f, \"events\": %ld, "
+              "\"seconds\": %.6f, \"events_per_second\": %.0f}",
+              scenarios_written > 0 ? "," : "", scenario.particles,
+              scenario.packing_fraction, scenario.scheduler.c_str(),
+              scenario.setup_seconds, scenario.events, scenario.seconds,
+              scenario.events / scenario.seconds);
+          fflush(file);
+          scenarios_written++;
+          std::cerr << "." << std::flush;
+        }
+      }
+    }
+    std::cerr << '\n';
+  }
+  fprintf(file, "%s]\n}\n", scenarios_written == 0 ? "" : "\n  ");
+
+  bool written {fflush(file) == 0 && !ferror(file)};
+  if (file != stdout) {
+    written = fclose(file) == 0 && written;
+  }
+  if (!written) {
+    std::cerr << "Cannot write " << (output.empty() ? "the results" : output)
+        << '\n';
+    return 1;
+  }
+  return 0;
+}
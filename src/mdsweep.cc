@@ -0,0 +1,154 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/sweep.h"
+#include "include/eventQueue.h"
+#include "include/lattice.h"
+#include "include/threadPool.h"
+
+// Parses a number from a command line argument.
+template <typename T>
+static bool ParseArgument(const char* argument, T* value) {
+  std::istringstream ss {argument};
+  if (!(ss >> *value)) {
+    std::cerr << "Invalid number " << argument << '\n';
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  if (argc < 4) {
+    printf("Please enter the particle radii, the spaces between the "
+    "particles and the frictions, each as a list a,b,c or a range "
+    "start:stop:step.\n"
+    "Options: --time T (duration of each run), --seeds N (runs per point), "
+    "--seed S (first seed), --scheduler heap|calendar, "
+    "--threads N (runs in parallel), --format csv|json, "
+    "--average (one line per point, averaged over the seeds), "
+    "--output path.\n");
+    return 1;
+  }
+
+  std::vector<double> radii, spacings, frictions;
+  if (!ParseValues(argv[1], &radii) || !ParseValues(argv[2], &spacings)
+      || !ParseValues(argv[3], &frictions)) {
+    return 1;
+  }
+  for (double radius : radii) {
+    for (double spacing : spacings) {
+      if (!IsLatticeValid(radius, spacing)) {
+        std::cerr << "Invalid crystal: radius " << radius << ", spacing "
+            << spacing << '\n';
+        return 1;
+      }
+    }
+  }
+
+  double duration {100.0};
+  int seeds {1};
+  unsigned int seed {0};
+  bool seeded {false};
+  EventQueue::Type scheduler {EventQueue::Type::kHeap};
+  int threads {0};
+  bool json {false};
+  bool average {false};
+  std::string output {};
+  for (int i {4}; i < argc; ++i) {
+    std::string option {argv[i]};
+    if (option == "--time" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &duration)) {
+        return 1;
+      }
+    } else if (option == "--seeds" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &seeds)) {
+        return 1;
+      }
+    } else if (option == "--seed" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &seed)) {
+        return 1;
+      }
+      seeded = true;
+    } else if (option == "--scheduler" && i + 1 < argc) {
+      std::string name {argv[++i]};
+      if (name == "heap") {
+        scheduler = EventQueue::Type::kHeap;
+      } else if (name == "calendar") {
+        scheduler = EventQueue::Type::kCalendar;
+      } else {
+        std::cerr << "Invalid scheduler " << name << '\n';
+        return 1;
+      }
+    } else if (option == "--threads" && i + 1 < argc) {
+      if (!ParseArgument(argv[++i], &threads)) {
+        return 1;
+      }
+    } else if (option == "--format" && i + 1 < argc) {
+      std::string name {argv[++i]};
+      if (name == "csv") {
+        json = false;
+      } else if (name == "json") {
+        json = true;
+      } else {
+        std::cerr << "Invalid format " << name << '\n';
+        return 1;
+      }
+    } else if (option == "--average") {
+      average = true;
+    } else if (option == "--output" && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      std::cerr << "Invalid option " << option << '\n';
+      return 1;
+    }
+  }
+  if (seeds < 1) {
+    std::cerr << "--seeds needs at least 1 run per point\n";
+    return 1;
+  }
+  if (!seeded) {
+    seed = std::random_device()();
+  }
+
+  // Opened first: a bad path fails before any run
+  FILE* file {stdout};
+  if (!output.empty()) {
+    file = fopen(output.c_str(), "w");
+    if (file == nullptr) {
+      std::cerr << "Cannot open " << output << '\n';
+      return 1;
+    }
+  }
+
+  // Runs are independent and of very uneven costs: threads steal runs from
+  // each other once done with their own, and write their results at once
+  std::vector<SweepPoint> points {MakeSweep(radii, spacings, frictions, seed,
+      seeds)};
+  SweepWriter writer {file, json, average, seeds};
+  ThreadPool pool {threads};
+  pool.ParallelForStealing(points.size(),
+      [&points, &writer, duration, scheduler](std::size_t begin,
+          std::size_t end, int thread) {
+        for (std::size_t k {begin}; k < end; ++k) {
+          writer.Add(k, RunSweepPoint(points[k], duration, scheduler));
+        }
+      });
+
+  bool written {writer.Close()};
+  if (file != stdout) {
+    written = fclose(file) == 0 && written;
+  }
+  if (!written) {
+    std::cerr << "Cannot write " << (output.empty() ? "the results" : output)
+        << '\n';
+    return 1;
+  }
+  return 0;
+}
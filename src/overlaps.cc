@@ -0,0 +1,62 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "include/main.h"
+#include "include/overlaps.h"
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/cellGrid.h"
+
+// Returns the pairs of particles overlapping by more than EPSILON, each pair
+// once with its smaller index first.
+std::vector<std::pair<int, int>> FindOverlaps(const ParticleStore& particles,
+    const CellGrid& grid) {
+  std::vector<std::pair<int, int>> overlaps;
+
+  int neighbors[9];
+  for (unsigned int i {0}; i < particles.Size(); ++i) {
+    if (!particles.IsAlive(i)) {
+      continue;
+    }
+
+    int neighbors_count {grid.GetNeighbors(grid.GetCell(i), neighbors)};
+    for (int k {0}; k < neighbors_count; ++k) {
+      for (int j {grid.GetFirst(neighbors[k])}; j != -1;
+          j = grid.GetNext(j)) {
+        if (j > static_cast<int>(i) && particles.Overlap(i, j) > EPSILON) {
+          overlaps.push_back(std::make_pair(i, j));
+        }
+      }
+    }
+  }
+
+  return overlaps;
+}
+
+// Returns the pairs of overlapping particles of a collection, indexed like
+// the collection.
+std::vector<std::pair<int, int>> FindOverlaps(
+    const std::vector<Particle>& particles) {
+  ParticleStore store;
+  double max_radius {0.0};
+  for (const auto& particle : particles) {
+    store.Add(particle);
+    max_radius = std::max(max_radius, particle.GetRadius());
+  }
+
+  // No particles, or point particles only: nothing overlaps
+  if (particles.empty() || max_radius <= 0.0) {
+    return std::vector<std::pair<int, int>>();
+  }
+
+  CellGrid grid;
+  grid.Reset(2 * max_radius, particles.size());
+  for (unsigned int i {0}; i < store.Size(); ++i) {
+    grid.Insert(i, grid.Locate(store.GetRx(i), store.GetRy(i)));
+  }
+
+  return FindOverlaps(store, grid);
+}
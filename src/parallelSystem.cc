@@ -0,0 +1,365 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/main.h"
+#include "include/parallelSystem.h"
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/eventQueue.h"
+#include "include/cellGrid.h"
+#include "include/domain.h"
+#include "include/threadPool.h"
+
+// Number of events each domain processes per epoch, on average, that the
+// duration of the epochs aims at: enough to make up for the barrier between
+// epochs, few enough to bound the changes kept to roll back.
+static constexpr long kEpochEvents {16384};
+
+// Number of events a domain processes between checks for messages, at most.
+// Threads run ahead of the others by about as many events of a domain at
+// most, so that rollbacks stay short.
+static constexpr long kBatchEvents {16};
+
+// Duration of the first epoch, adjusted in later epochs.
+static constexpr double kFirstWindow {0.01};
+
+// Initializes a system with the specified collection of particles, split
+// into the specified number of domains, each running on the specified
+// scheduler.
+ParallelSystem::ParallelSystem(std::vector<Particle> particles,
+    double friction, int domains, EventQueue::Type scheduler) :
+    pool_ {new ThreadPool()},
+    time_ {0},
+    end_ {0}, window_ {kFirstWindow},
+    wall_size_ {BOX_SIZE},
+    deliveries_ {0},
+    waiting_ {0},
+    ended_ {false} {
+  double max_radius {0.0};
+  for (const auto& particle : particles) {
+    particles_.Add(particle);
+    max_radius = std::max(max_radius, particle.GetRadius());
+  }
+
+  // Columns of the particles, on the grid every domain uses
+  CellGrid grid;
+  grid.Reset(2 * max_radius, 0);
+  int columns {grid.GetSize()};
+  std::vector<int> column(particles.size());
+  std::vector<long> counts(columns, 0);
+  for (unsigned int i {0}; i < particles.size(); ++i) {
+    column[i] = grid.GetColumn(grid.Locate(particles[i].GetRx(),
+        particles[i].GetRy()));
+    counts[column[i]]++;
+  }
+
+  // First column of each domain, so that domains hold as many particles as
+  // possible each, with 2 columns at least
+  domains = std::max(1, std::min(domains, columns / 2));
+  std::vector<int> first_columns(domains + 1, columns);
+  first_columns[0] = 0;
+  long seen {0};
+  int domain {1};
+  for (int c {0}; c < columns && domain < domains; ++c) {
+    seen += counts[c];
+    int next {c + 1};
+    if (next - first_columns[domain - 1] >= 2
+        && (seen * domains >= domain * static_cast<long>(particles.size())
+        || columns - next == 2 * (domains - domain))) {
+      first_columns[domain++] = next;
+    }
+  }
+
+  std::vector<int> owners(columns);
+  for (int d {0}; d < domains; ++d) {
+    domains_.emplace_back(new Domain(d, first_columns[d],
+        first_columns[d + 1] - 1, 2 * max_radius, friction, wall_size_,
+        scheduler));
+    for (int c {first_columns[d]}; c < first_columns[d + 1]; ++c) {
+      owners[c] = d;
+    }
+  }
+  inboxes_.resize(domains);
+
+  // Particles of the first column of a domain are ghosts in the previous one
+  for (unsigned int i {0}; i < particles.size(); ++i) {
+    int owner {owners[column[i]]};
+    domains_[owner]->Add(i, particles[i], false);
+    if (owner > 0 && column[i] == first_columns[owner]) {
+      domains_[owner - 1]->Add(i, particles[i], true);
+    }
+  }
+
+  pool_->ParallelFor(domains_.size(),
+      [this](std::size_t begin, std::size_t end, int thread) {
+        for (std::size_t d {begin}; d < end; ++d) {
+          domains_[d]->Start(time_);
+        }
+      });
+}
+
+// Processes every event scheduled before time t, then moves every particle
+// to time t.
+void ParallelSystem::RunUntil(double t) {
+  while (time_ < t) {
+    time_ = RunEpoch(std::min(t, time_ + window_));
+  }
+  time_ = t;
+
+  pool_->ParallelFor(domains_.size(),
+      [this](std::size_t begin, std::size_t end, int thread) {
+        for (std::size_t d {begin}; d < end; ++d) {
+          domains_[d]->Collect(time_, &particles_);
+        }
+      });
+  particles_.SumTotals();
+}
+
+// Returns the particles, as of the last call to RunUntil().
+const ParticleStore& ParallelSystem::GetParticles() const {
+  return particles_;
+}
+
+// Returns the simulation clock time.
+double ParallelSystem::GetTime() const {
+  return time_;
+}
+
+// Returns the size of the simulation box.
+double ParallelSystem::GetWallSize() const {
+  return wall_size_;
+}
+
+// Returns the number of collisions processed so far.
+long ParallelSystem::GetCollisions() const {
+  long collisions {0};
+  for (const auto& domain : domains_) {
+    collisions += domain->GetCollisions();
+  }
+  return collisions;
+}
+
+// Returns the average kinetic energy of the particles.
+double ParallelSystem::GetAverageKineticEnergy() const {
+  if (particles_.Count() == 0) {
+    return 0.0;
+  }
+
+  return particles_.GetKineticEnergy() / particles_.Count();
+}
+
+// Returns the number of domains.
+int ParallelSystem::GetDomains() const {
+  return domains_.size();
+}
+
+// Returns the number of events and messages undone so far.
+long ParallelSystem::GetRollbacks() const {
+  long rollbacks {0};
+  for (const auto& domain : domains_) {
+    rollbacks += domain->GetRollbacks();
+  }
+  return rollbacks;
+}
+
+// Sets the number of threads running the domains.
+void ParallelSystem::SetThreads(int threads) {
+  pool_.reset(new ThreadPool(threads));
+}
+
+// Runs every domain up to time end, and returns the earliest time of the
+// events left. Every event before time end is final by then. The duration
+// of the next epoch follows from the number of events of this one.
+double ParallelSystem::RunEpoch(double end) {
+  long events {0};
+  for (const auto& domain : domains_) {
+    events -= domain->GetEvents();
+  }
+
+  // Each thread runs a contiguous range of domains, or the calling thread
+  // runs them all. No thread runs until every one has a frontier.
+  end_ = end;
+  waiting_ = 0;
+  ended_ = false;
+  int threads {pool_->GetThreads()};
+  if (domains_.size() < static_cast<std::size_t>(threads)) {
+    threads = 1;
+  }
+  if (frontiers_.size() != static_cast<std::size_t>(threads)) {
+    frontiers_ = std::vector<std::atomic<double>>(threads);
+  }
+  for (auto& frontier : frontiers_) {
+    frontier = -INFINITY;
+  }
+  pool_->ParallelFor(domains_.size(),
+      [this, threads](std::size_t begin, std::size_t stop, int thread) {
+        RunDomains(begin, stop, thread, threads);
+      });
+
+  double next {INFINITY};
+  for (const auto& domain : domains_) {
+    next = std::min(next, domain->GetNextTime());
+    domain->Commit(end);
+    events += domain->GetEvents();
+  }
+
+  long target {kEpochEvents * static_cast<long>(domains_.size())};
+  if (events > 2 * target) {
+    window_ /= 2;
+  } else if (2 * events < target) {
+    window_ *= 2;
+  }
+  return next;
+}
+
+// Runs the domains [begin, end) up to the end of the epoch, on the specified
+// thread out of threads. The domain of the earliest event or message runs,
+// up to the earliest one of the other domains: a thread processes the
+// events of its domains in time order, and only messages from other threads
+// roll them back. A domain alone on its thread runs a batch of events at a
+// time. A thread too far ahead of the others yields to them.
+void ParallelSystem::RunDomains(std::size_t begin, std::size_t end,
+    int thread, int threads) {
+  std::vector<std::vector<Message>> messages(end - begin);
+
+  // Times of the next event or message of each domain, which only change
+  // when it runs or receives messages
+  std::vector<double> next_times(end - begin);
+  for (std::size_t d {begin}; d < end; ++d) {
+    next_times[d - begin] = domains_[d]->GetNextTime();
+  }
+  long deliveries {-1};
+  for (;;) {
+    if (deliveries_.load(std::memory_order_acquire) != deliveries) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      deliveries = deliveries_.load(std::memory_order_relaxed);
+      for (std::size_t d {begin}; d < end; ++d) {
+        messages[d - begin].swap(inboxes_[d]);
+      }
+    }
+
+    // Domains which received messages send the cancellations of their
+    // rollbacks at once, before any other domain runs past them
+    bool sent {false};
+    for (std::size_t d {begin}; d < end; ++d) {
+      if (messages[d - begin].empty()) {
+        continue;
+      }
+      domains_[d]->Receive(messages[d - begin]);
+      messages[d - begin].clear();
+      domains_[d]->Run(end_, 0);
+      next_times[d - begin] = domains_[d]->GetNextTime();
+      std::vector<Message> cancellations {domains_[d]->TakeMessages()};
+      sent = sent || !cancellations.empty();
+      Deliver(cancellations);
+    }
+    if (sent) {
+      continue;
+    }
+
+    // Earliest domain, and the earliest time of the others
+    std::size_t earliest {end};
+    double first {INFINITY}, second {INFINITY};
+    for (std::size_t d {begin}; d < end; ++d) {
+      double next {next_times[d - begin]};
+      if (next < first) {
+        second = first;
+        first = next;
+        earliest = d;
+      } else {
+        second = std::min(second, next);
+      }
+    }
+    if (first >= end_) {
+      frontiers_[thread].store(INFINITY, std::memory_order_relaxed);
+      if (!WaitForMessages(begin, end, threads)) {
+        return;
+      }
+      continue;
+    }
+    frontiers_[thread].store(first, std::memory_order_relaxed);
+    if (IsAhead(thread, threads, first)) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    // Events simultaneous with the earliest of the other domains run too,
+    // so that the domain always makes progress
+    domains_[earliest]->Run(std::min(end_, std::nextafter(second, INFINITY)),
+        kBatchEvents);
+    next_times[earliest - begin] = domains_[earliest]->GetNextTime();
+    Deliver(domains_[earliest]->TakeMessages());
+  }
+}
+
+// Returns whether the specified thread, out of threads, whose domains have
+// their earliest event or message at time t, runs too far ahead of the
+// other threads: by more than kBatchEvents events of a domain, as of the
+// number of events per epoch aimed at.
+bool ParallelSystem::IsAhead(int thread, int threads, double t) const {
+  double lag {window_ * kBatchEvents / kEpochEvents};
+  for (int other {0}; other < threads; ++other) {
+    if (other != thread
+        && t > frontiers_[other].load(std::memory_order_relaxed) + lag) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Delivers the specified messages to their domains.
+void ParallelSystem::Deliver(const std::vector<Message>& messages) {
+  if (messages.empty()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& message : messages) {
+      inboxes_[message.to].push_back(message);
+    }
+    deliveries_.fetch_add(1, std::memory_order_release);
+  }
+  delivered_.notify_all();
+}
+
+// Waits for messages to the domains [begin, end), and returns false if the
+// epoch ends first: every thread out of threads is waiting, with no message
+// left to receive, so that no message may arrive any more.
+bool ParallelSystem::WaitForMessages(std::size_t begin, std::size_t end,
+    int threads) {
+  auto arrived = [this](std::size_t first, std::size_t last) {
+    for (std::size_t d {first}; d < last; ++d) {
+      if (!inboxes_[d].empty()) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (arrived(begin, end)) {
+    return true;
+  }
+  if (++waiting_ == threads && !arrived(0, inboxes_.size())) {
+    ended_ = true;
+    delivered_.notify_all();
+    return false;
+  }
+  delivered_.wait(lock, [this, &arrived, begin, end] {
+    return ended_ || arrived(begin, end);
+  });
+  if (ended_) {
+    return false;
+  }
+  --waiting_;
+  return true;
+}
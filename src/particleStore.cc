@@ -0,0 +1,657 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <atomic>
+#include <cstdio>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "include/main.h"
+#include "include/particle.h"
+#include "include/serializer.h"
+#include "include/speedHistogram.h"
+#include "include/particleStore.h"
+#include "include/cpu.h"
+
+#ifdef MDSIM_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef MDSIM_AVX2
+// Returns the four values at the specified indices. Masked, from zeros:
+// the plain gather starts from an undefined vector, which GCC reports as
+// uninitialized once optimizing.
+__attribute__((target("avx2")))
+static inline __m256d Gather(const double* values, __m128i indices) {
+  return _mm256_mask_i32gather_pd(_mm256_setzero_pd(), values, indices,
+      _mm256_castsi256_pd(_mm256_set1_epi64x(-1)), 8);
+}
+
+// Computes the amount of time for particle i to collide with each of the
+// count candidates, four at a time, and returns the number of candidates
+// done. Overlapping pairs get NaN, so that the caller reports them.
+// Operations are the same as in ParticleStore::TimeToHit(): both give the
+// same times, to the last bit.
+__attribute__((target("avx2")))
+static int TimeToHitAvx2(const double* rx, const double* ry,
+    const double* vx, const double* vy, const double* radius, int i,
+    const int* candidates, int count, double* times) {
+  const __m256d zero {_mm256_setzero_pd()};
+  const __m256d infinity {_mm256_set1_pd(INFINITY)};
+  const __m256d nan {_mm256_set1_pd(NAN)};
+  const __m256d rxi {_mm256_set1_pd(rx[i])}, ryi {_mm256_set1_pd(ry[i])};
+  const __m256d vxi {_mm256_set1_pd(vx[i])}, vyi {_mm256_set1_pd(vy[i])};
+  const __m256d radiusi {_mm256_set1_pd(radius[i])};
+
+  int batches {count / 4};
+  for (int batch {0}; batch < batches; ++batch) {
+    int k {4 * batch};
+    __m128i j {_mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(candidates + k))};
+    __m256d dx {_mm256_sub_pd(Gather(rx, j), rxi)};
+    __m256d dy {_mm256_sub_pd(Gather(ry, j), ryi)};
+    __m256d dvx {_mm256_sub_pd(Gather(vx, j), vxi)};
+    __m256d dvy {_mm256_sub_pd(Gather(vy, j), vyi)};
+    __m256d sigma {_mm256_add_pd(radiusi, Gather(radius, j))};
+
+    __m256d dvdr {_mm256_add_pd(_mm256_mul_pd(dx, dvx),
+        _mm256_mul_pd(dy, dvy))};
+    __m256d dvdv {_mm256_add_pd(_mm256_mul_pd(dvx, dvx),
+        _mm256_mul_pd(dvy, dvy))};
+    __m256d drdr {_mm256_add_pd(_mm256_mul_pd(dx, dx),
+        _mm256_mul_pd(dy, dy))};
+    __m256d gap {_mm256_sub_pd(drdr, _mm256_mul_pd(sigma, sigma))};
+    __m256d d {_mm256_sub_pd(_mm256_mul_pd(dvdr, dvdr),
+        _mm256_mul_pd(dvdv, gap))};
+    __m256d t {_mm256_div_pd(
+        _mm256_sub_pd(zero, _mm256_add_pd(dvdr, _mm256_sqrt_pd(d))), dvdv)};
+
+    // Same early-outs as the scalar version, as masks
+    __m256d approaching {_mm256_cmp_pd(dvdr, zero, _CMP_LT_OQ)};
+    __m256d overlapping {_mm256_and_pd(approaching,
+        _mm256_cmp_pd(gap, zero, _CMP_LT_OQ))};
+    __m256d hitting {_mm256_and_pd(approaching,
+        _mm256_cmp_pd(d, zero, _CMP_GE_OQ))};
+    t = _mm256_blendv_pd(infinity, t, hitting);
+    t = _mm256_blendv_pd(t, nan, overlapping);
+    _mm256_storeu_pd(times + k, t);
+  }
+  return 4 * batches;
+}
+#endif
+
+// Returns the amount of time for a particle at position r, with velocity v
+// along one axis, to collide with one of the two walls of this axis. The
+// walls move apart at wall_speed each: a particle only hits a wall it moves
+// faster than. Particles slightly past a wall, because of floating point
+// errors, hit it at once.
+static double TimeToHitWalls(double r, double v, double radius,
+    double wall_size, double wall_speed) {
+  double left {(WINDOW_SIZE - wall_size) / 2};
+  double right {left + wall_size};
+  double dt_left {fmin(radius - r + left, 0.0) / (v + wall_speed)};
+  double dt_right {fmax(right - r - radius, 0.0) / (v - wall_speed)};
+  return fmin(v + wall_speed < 0 ? dt_left : INFINITY,
+      v - wall_speed > 0 ? dt_right : INFINITY);
+}
+
+// Initializes an empty store.
+ParticleStore::ParticleStore() :
+    count_alive_ {0},
+    kinetic_energy_ {0.0},
+    momentum_x_ {0.0}, momentum_y_ {0.0},
+    area_ {0.0},
+    overlaps_ {0} {}
+
+// Adds a particle, positioned as of its birthdate, and returns its index.
+int ParticleStore::Add(const Particle& particle) {
+  int i {0};
+  if (!free_.empty()) {
+    // The collision count of a removed particle is kept, so that the events
+    // predicted for it stay invalid
+    i = free_.back();
+    free_.pop_back();
+  } else {
+    i = rx_.size();
+    rx_.push_back(0.0);
+    ry_.push_back(0.0);
+    vx_.push_back(0.0);
+    vy_.push_back(0.0);
+    radius_.push_back(0.0);
+    mass_.push_back(0.0);
+    time_.push_back(0.0);
+    birthdate_.push_back(0.0);
+    count_.push_back(0);
+    alive_.push_back(0);
+  }
+
+  rx_[i] = particle.GetRx();
+  ry_[i] = particle.GetRy();
+  vx_[i] = particle.GetVx();
+  vy_[i] = particle.GetVy();
+  radius_[i] = particle.GetRadius();
+  mass_[i] = particle.GetMass();
+  time_[i] = particle.GetBirthdate();
+  birthdate_[i] = particle.GetBirthdate();
+  alive_[i] = 1;
+  ++count_alive_;
+
+  AddMotion(i);
+  area_ += M_PI * radius_[i] * radius_[i];
+  return i;
+}
+
+// Removes particle i. Its index is free for a later particle.
+void ParticleStore::Remove(int i) {
+  if (!IsAlive(i)) {
+    return;
+  }
+
+  // Invalidates the events of the other particles involving it
+  count_[i]++;
+  alive_[i] = 0;
+  free_.push_back(i);
+  --count_alive_;
+
+  // An empty store has no rounding errors left
+  if (count_alive_ == 0) {
+    kinetic_energy_ = 0.0;
+    momentum_x_ = 0.0;
+    momentum_y_ = 0.0;
+    area_ = 0.0;
+    if (speeds_) {
+      speeds_->Clear();
+    }
+  } else {
+    SubtractMotion(i);
+    area_ -= M_PI * radius_[i] * radius_[i];
+  }
+}
+
+// Returns whether index i holds a particle.
+bool ParticleStore::IsAlive(int i) const {
+  return alive_[i] != 0;
+}
+
+// Returns the number of particles.
+std::size_t ParticleStore::Count() const {
+  return count_alive_;
+}
+
+// Removes every particle.
+void ParticleStore::Clear() {
+  rx_.clear();
+  ry_.clear();
+  vx_.clear();
+  vy_.clear();
+  radius_.clear();
+  mass_.clear();
+  time_.clear();
+  birthdate_.clear();
+  count_.clear();
+  alive_.clear();
+  free_.clear();
+  count_alive_ = 0;
+  kinetic_energy_ = 0.0;
+  momentum_x_ = 0.0;
+  momentum_y_ = 0.0;
+  area_ = 0.0;
+  if (speeds_) {
+    speeds_->Clear();
+  }
+}
+
+// Returns the number of indices: particle indices are all below it, but
+// some of them may be free, see IsAlive().
+std::size_t ParticleStore::Size() const {
+  return rx_.size();
+}
+
+// Returns a copy of particle i, as of its last update.
+Particle ParticleStore::Get(int i) const {
+  return Particle(birthdate_[i], rx_[i], ry_[i], vx_[i], vy_[i],
+      radius_[i], mass_[i]);
+}
+
+// Moves particle i to time t, from the time of its last update.
+void ParticleStore::Update(int i, double t) {
+  double dt {t - time_[i]};
+  rx_[i] += vx_[i] * dt;
+  ry_[i] += vy_[i] * dt;
+  time_[i] = t;
+}
+
+// Returns the state of particle i.
+ParticleStore::State ParticleStore::GetState(int i) const {
+  return State {rx_[i], ry_[i], vx_[i], vy_[i], time_[i]};
+}
+
+// Sets the state of particle i. Its events become invalid.
+void ParticleStore::SetState(int i, const State& state) {
+  if (IsAlive(i)) {
+    SubtractMotion(i);
+  }
+  rx_[i] = state.rx;
+  ry_[i] = state.ry;
+  vx_[i] = state.vx;
+  vy_[i] = state.vy;
+  time_[i] = state.time;
+  count_[i]++;
+  if (IsAlive(i)) {
+    AddMotion(i);
+  }
+}
+
+// Sets the state of particle i, leaving the totals out of date until
+// SumTotals(). Its events become invalid.
+void ParticleStore::SetStateOnly(int i, const State& state) {
+  rx_[i] = state.rx;
+  ry_[i] = state.ry;
+  vx_[i] = state.vx;
+  vy_[i] = state.vy;
+  time_[i] = state.time;
+  count_[i]++;
+}
+
+// Sums the totals again, from every particle: they only depend on the
+// particles.
+void ParticleStore::SumTotals() {
+  kinetic_energy_ = 0.0;
+  momentum_x_ = 0.0;
+  momentum_y_ = 0.0;
+  area_ = 0.0;
+  if (speeds_) {
+    speeds_->Clear();
+  }
+  for (std::size_t i {0}; i < rx_.size(); ++i) {
+    if (alive_[i]) {
+      AddMotion(i);
+      area_ += M_PI * radius_[i] * radius_[i];
+    }
+  }
+}
+
+// Returns the amount of time for particle i to collide with particle j,
+// assuming no intervening collisions. Overlapping particles never collide:
+// they are counted, see GetOverlaps().
+double ParticleStore::TimeToHit(int i, int j) const {
+  if (i == j) {
+    return INFINITY;
+  }
+
+  double dx {rx_[j] - rx_[i]};
+  double dy {ry_[j] - ry_[i]};
+  double dvx {vx_[j] - vx_[i]};
+  double dvy {vy_[j] - vy_[i]};
+
+  // Dot product dv.dr
+  double dvdr {dx * dvx + dy * dvy};
+  // Dot product dv.dv
+  double dvdv {dvx * dvx + dvy * dvy};
+  // Dot product dr.dr
+  double drdr {dx * dx + dy * dy};
+  if (dvdr >= 0) {
+    return INFINITY;
+  }
+
+  // Distance between particles centers
+  double sigma {radius_[i] + radius_[j]};
+  if (drdr - sigma * sigma < 0) {
+    overlaps_.fetch_add(1, std::memory_order_relaxed);
+    return INFINITY;
+  }
+
+  double d {(dvdr * dvdr) - dvdv * (drdr - sigma * sigma)};
+  if (d < 0) {
+    return INFINITY;
+  }
+
+  return -(dvdr + sqrt(d)) / dvdv;
+}
+
+// Computes the amount of time for particle i to collide with each of the
+// count candidates in times, and returns the position of the earliest
+// collision in candidates, -1 if none.
+int ParticleStore::TimeToHit(int i, const int* candidates, int count,
+    double* times) const {
+  int k {0};
+  if (HasAvx2()) {
+#ifdef MDSIM_AVX2
+    k = TimeToHitAvx2(rx_.data(), ry_.data(), vx_.data(), vy_.data(),
+        radius_.data(), i, candidates, count, times);
+#endif
+  }
+  for (; k < count; ++k) {
+    times[k] = TimeToHit(i, candidates[k]);
+  }
+
+  int earliest {-1};
+  for (k = 0; k < count; ++k) {
+    // Overlapping pairs are reported by the scalar version
+    if (std::isnan(times[k])) {
+      times[k] = TimeToHit(i, candidates[k]);
+    }
+    if (times[k] != INFINITY
+        && (earliest == -1 || times[k] < times[earliest])) {
+      earliest = k;
+    }
+  }
+  return earliest;
+}
+
+// Returns the amount of time for particle i to collide with a vertical
+// wall, assuming no intervening collisions.
+double ParticleStore::TimeToHitVerticalWall(int i, double wall_size,
+    double wall_speed) const {
+  return TimeToHitWalls(rx_[i], vx_[i], radius_[i], wall_size, wall_speed);
+}
+
+// Returns the amount of time for particle i to collide with a horizontal
+// wall, assuming no intervening collisions.
+double ParticleStore::TimeToHitHorizontalWall(int i, double wall_size,
+    double wall_speed) const {
+  return TimeToHitWalls(ry_[i], vy_[i], radius_[i], wall_size, wall_speed);
+}
+
+// Returns by how much particles i and j overlap: the sum of their radii minus
+// the distance between their centers. Negative if they do not overlap.
+double ParticleStore::Overlap(int i, int j) const {
+  double dx {rx_[j] - rx_[i]};
+  double dy {ry_[j] - ry_[i]};
+  return radius_[i] + radius_[j] - sqrt(dx * dx + dy * dy);
+}
+
+// Moves particles i and j apart along the line of their centers, half way
+// each, until they no longer overlap. Their events become invalid.
+void ParticleStore::PushApart(int i, int j) {
+  double dx {rx_[j] - rx_[i]};
+  double dy {ry_[j] - ry_[i]};
+  double distance {sqrt(dx * dx + dy * dy)};
+
+  // Particles at the same position are pushed apart horizontally
+  if (distance == 0) {
+    dx = 1.0;
+    dy = 0.0;
+    distance = 1.0;
+  }
+
+  double shift {(radius_[i] + radius_[j] + EPSILON - distance) / 2};
+  if (shift <= 0) {
+    return;
+  }
+  rx_[i] -= shift * dx / distance;
+  ry_[i] -= shift * dy / distance;
+  rx_[j] += shift * dx / distance;
+  ry_[j] += shift * dy / distance;
+
+  count_[i]++;
+  count_[j]++;
+}
+
+// Updates the velocities of particles i and j according to the laws of
+// elastic (or inelastic, with friction) collision, and returns the virial of
+// the collision.
+double ParticleStore::BounceOff(int i, int j, double friction) {
+  double dx {rx_[j] - rx_[i]};
+  double dy {ry_[j] - ry_[i]};
+  double dvx {vx_[j] - vx_[i]};
+  double dvy {vy_[j] - vy_[i]};
+
+  // Dot product dv.dr
+  double dvdr {dx * dvx + dy * dvy};
+
+  // Distance between particles centers at collision.
+  double dist {radius_[i] + radius_[j]};
+
+  // Magnitude of normal force
+  double magnitude {(1 + friction) * mass_[i] * mass_[j] * dvdr /
+    ((mass_[i] + mass_[j]) * dist)};
+
+  // Normal force in x and y directions
+  double fx {magnitude * dx / dist};
+  double fy {magnitude * dy / dist};
+
+  // Update velocities according to normal force
+  SubtractMotion(i);
+  SubtractMotion(j);
+  vx_[i] += fx / mass_[i];
+  vy_[i] += fy / mass_[i];
+  vx_[j] -= fx / mass_[j];
+  vy_[j] -= fy / mass_[j];
+  AddMotion(i);
+  AddMotion(j);
+
+  // Update collision counts
+  count_[i]++;
+  count_[j]++;
+
+  // The particles approach: the magnitude is negative
+  return -magnitude * dist;
+}
+
+// Updates the velocity of particle i upon collision with a vertical wall, and
+// returns the momentum given to the wall.
+double ParticleStore::BounceOffVerticalWall(int i, double wall_speed) {
+  double vx {vx_[i]};
+  SubtractMotion(i);
+  if (vx_[i] > 0 && rx_[i] > WINDOW_SIZE / 2) {
+    vx_[i] = -vx_[i] + 2 * wall_speed;
+  } else if (vx_[i] > 0 && rx_[i] < WINDOW_SIZE / 2) {
+    vx_[i] += -2 * wall_speed;
+  } else if (vx_[i] < 0 && rx_[i] < WINDOW_SIZE / 2) {
+    vx_[i] = -vx_[i] - 2 * wall_speed;
+  } else if (vx_[i] < 0 && rx_[i] > WINDOW_SIZE / 2) {
+    vx_[i] += 2 * wall_speed;
+  } else {
+    vx_[i] = 2 * wall_speed;
+  }
+  AddMotion(i);
+  count_[i]++;
+  return mass_[i] * fabs(vx_[i] - vx);
+}
+
+// Updates the velocity of particle i upon collision with a
+// horizontal wall, and returns the momentum given to the wall.
+double ParticleStore::BounceOffHorizontalWall(int i,
+    double wall_speed) {
+  double vy {vy_[i]};
+  SubtractMotion(i);
+  if (vy_[i] > 0 && ry_[i] > WINDOW_SIZE / 2) {
+    vy_[i] = -vy_[i] + 2 * wall_speed;
+  } else if (vy_[i] > 0 && ry_[i] < WINDOW_SIZE / 2) {
+    vy_[i] += -2 * wall_speed;
+  } else if (vy_[i] < 0 && ry_[i] < WINDOW_SIZE / 2) {
+    vy_[i] = -vy_[i] - 2 * wall_speed;
+  } else if (vy_[i] < 0 && ry_[i] > WINDOW_SIZE / 2) {
+    vy_[i] += 2 * wall_speed;
+  } else {
+    vy_[i] = 2 * wall_speed;
+  }
+  AddMotion(i);
+  count_[i]++;
+  return mass_[i] * fabs(vy_[i] - vy);
+}
+
+// Returns the kinetic energy of particle i.
+double ParticleStore::KineticEnergy(int i) const {
+  double kinetic_energy {0.5 * mass_[i] * MASS_UNIT
+      * pow(SPEED_UNIT * GetSpeed(i), 2)};
+  return kinetic_energy;
+}
+
+// Returns the total kinetic energy of the particles, in joules.
+double ParticleStore::GetKineticEnergy() const {
+  return kinetic_energy_ * MASS_UNIT * SPEED_UNIT * SPEED_UNIT;
+}
+
+// Returns the total momentum of the particles along x, in kg.m/s.
+double ParticleStore::GetMomentumX() const {
+  return momentum_x_ * MASS_UNIT * SPEED_UNIT;
+}
+
+// Returns the total momentum of the particles along y, in kg.m/s.
+double ParticleStore::GetMomentumY() const {
+  return momentum_y_ * MASS_UNIT * SPEED_UNIT;
+}
+
+// Returns the area the particles cover, overlaps counted twice.
+double ParticleStore::GetArea() const {
+  return area_;
+}
+
+// Starts counting the speeds of the particles in a histogram of buckets of
+// the specified size, kept up to date from then on.
+void ParticleStore::TrackSpeeds(double bucket_size) {
+  speeds_.reset(new SpeedHistogram(bucket_size));
+  for (unsigned int i {0}; i < Size(); ++i) {
+    if (IsAlive(i)) {
+      speeds_->Add(GetSpeed(i));
+    }
+  }
+}
+
+// Returns the histogram of the speeds of the particles, nullptr until
+// TrackSpeeds() is called.
+const SpeedHistogram* ParticleStore::GetSpeedHistogram() const {
+  return speeds_.get();
+}
+
+// Returns the speed of particle i.
+double ParticleStore::GetSpeed(int i) const {
+  return sqrt(vx_[i] * vx_[i] + vy_[i] * vy_[i]);
+}
+
+// Returns the rx coordinate of particle i.
+double ParticleStore::GetRx(int i) const {
+  return rx_[i];
+}
+
+// Sets the rx coordinate of particle i.
+void ParticleStore::SetRx(int i, double rx) {
+  rx_[i] = rx;
+}
+
+// Returns the ry coordinate of particle i.
+double ParticleStore::GetRy(int i) const {
+  return ry_[i];
+}
+
+// Sets the ry coordinate of particle i.
+void ParticleStore::SetRy(int i, double ry) {
+  ry_[i] = ry;
+}
+
+// Returns the vx velocity of particle i.
+double ParticleStore::GetVx(int i) const {
+  return vx_[i];
+}
+
+// Returns the vy velocity of particle i.
+double ParticleStore::GetVy(int i) const {
+  return vy_[i];
+}
+
+// Returns the radius of particle i.
+double ParticleStore::GetRadius(int i) const {
+  return radius_[i];
+}
+
+// Returns the mass of particle i.
+double ParticleStore::GetMass(int i) const {
+  return mass_[i];
+}
+
+// Returns the time of the last update of particle i.
+double ParticleStore::GetTime(int i) const {
+  return time_[i];
+}
+
+// Returns the birthdate of particle i.
+double ParticleStore::GetBirthdate(int i) const {
+  return birthdate_[i];
+}
+
+// Returns the number of collisions of each particle with either walls or
+// other particles.
+const std::vector<int>& ParticleStore::GetCounts() const {
+  return count_;
+}
+
+// Returns the number of overlapping pairs TimeToHit() met so far.
+long ParticleStore::GetOverlaps() const {
+  return overlaps_.load(std::memory_order_relaxed);
+}
+
+// Writes every particle and free index, for a checkpoint.
+void ParticleStore::Save(Serializer* out) const {
+  out->Write(rx_);
+  out->Write(ry_);
+  out->Write(vx_);
+  out->Write(vy_);
+  out->Write(radius_);
+  out->Write(mass_);
+  out->Write(time_);
+  out->Write(birthdate_);
+  out->Write(count_);
+  out->Write(alive_);
+  out->Write(free_);
+  out->Write(static_cast<uint64_t>(count_alive_));
+  out->Write(GetOverlaps());
+}
+
+// Reads back the particles Save() wrote, and returns false if they are
+// inconsistent. The free indices keep their order, so that particles added
+// later get the same indices as they would have.
+bool ParticleStore::Restore(Deserializer* in) {
+  uint64_t count_alive {0};
+  long overlaps {0};
+  if (!in->Read(&rx_) || !in->Read(&ry_) || !in->Read(&vx_)
+      || !in->Read(&vy_) || !in->Read(&radius_) || !in->Read(&mass_)
+      || !in->Read(&time_) || !in->Read(&birthdate_) || !in->Read(&count_)
+      || !in->Read(&alive_) || !in->Read(&free_)
+      || !in->Read(&count_alive) || !in->Read(&overlaps)) {
+    return false;
+  }
+  count_alive_ = count_alive;
+  overlaps_ = overlaps;
+
+  std::size_t size {rx_.size()};
+  for (const auto* values : {&ry_, &vx_, &vy_, &radius_, &mass_, &time_,
+      &birthdate_}) {
+    if (values->size() != size) {
+      return false;
+    }
+  }
+  if (count_.size() != size || alive_.size() != size
+      || count_alive_ + free_.size() != size) {
+    return false;
+  }
+  for (int i : free_) {
+    if (i < 0 || i >= static_cast<int>(size) || alive_[i]) {
+      return false;
+    }
+  }
+
+  SumTotals();
+  return true;
+}
+
+// Adds the motion of particle i to the totals.
+void ParticleStore::AddMotion(int i) {
+  kinetic_energy_ += 0.5 * mass_[i] * (vx_[i] * vx_[i] + vy_[i] * vy_[i]);
+  momentum_x_ += mass_[i] * vx_[i];
+  momentum_y_ += mass_[i] * vy_[i];
+  if (speeds_) {
+    speeds_->Add(GetSpeed(i));
+  }
+}
+
+// Takes the motion of particle i away from the totals.
+void ParticleStore::SubtractMotion(int i) {
+  kinetic_energy_ -= 0.5 * mass_[i] * (vx_[i] * vx_[i] + vy_[i] * vy_[i]);
+  momentum_x_ -= mass_[i] * vx_[i];
+  momentum_y_ -= mass_[i] * vy_[i];
+  if (speeds_) {
+    speeds_->Remove(GetSpeed(i));
+  }
+}
@@ -0,0 +1,93 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "include/pressureMeter.h"
+
+// Initializes a meter summing over the specified window of simulation time,
+// split into the specified number of bins, from time t on.
+PressureMeter::PressureMeter(double window, int bins, double t) :
+    width_ {0.0},
+    bins_ {std::max(bins, 1)},
+    start_ {0.0}, time_ {0.0},
+    bin_ {0},
+    wall_sum_ {0.0}, virial_sum_ {0.0} {
+  Reset(window, t);
+}
+
+// Empties the meter, which now sums over the specified window from time t
+// on.
+void PressureMeter::Reset(double window, double t) {
+  width_ = window / bins_;
+  start_ = t;
+  time_ = t;
+  bin_ = 0;
+  wall_.assign(bins_ + 1, 0.0);
+  virial_.assign(bins_ + 1, 0.0);
+  wall_sum_ = 0.0;
+  virial_sum_ = 0.0;
+}
+
+// Moves the meter to time t, dropping the bins older than the window. The
+// totals are summed again from the bins rather than updated, so that no
+// rounding error builds up.
+void PressureMeter::Advance(double t) {
+  time_ = t;
+  long bin {static_cast<long>(std::floor((t - start_) / width_))};
+  if (bin <= bin_) {
+    return;
+  }
+
+  int slots {bins_ + 1};
+  if (bin - bin_ >= slots) {
+    std::fill(wall_.begin(), wall_.end(), 0.0);
+    std::fill(virial_.begin(), virial_.end(), 0.0);
+  } else {
+    for (long k {bin_ + 1}; k <= bin; ++k) {
+      wall_[k % slots] = 0.0;
+      virial_[k % slots] = 0.0;
+    }
+  }
+  bin_ = bin;
+
+  wall_sum_ = 0.0;
+  virial_sum_ = 0.0;
+  for (int k {0}; k < slots; ++k) {
+    wall_sum_ += wall_[k];
+    virial_sum_ += virial_[k];
+  }
+}
+
+// Adds the momentum given to a wall.
+void PressureMeter::AddWallImpulse(double impulse) {
+  wall_[bin_ % (bins_ + 1)] += impulse;
+  wall_sum_ += impulse;
+}
+
+// Adds the virial of a collision between particles.
+void PressureMeter::AddVirial(double virial) {
+  virial_[bin_ % (bins_ + 1)] += virial;
+  virial_sum_ += virial;
+}
+
+// Returns the momentum given to the walls over the window.
+double PressureMeter::GetWallImpulse() const {
+  return wall_sum_;
+}
+
+// Returns the virial of the collisions over the window.
+double PressureMeter::GetVirial() const {
+  return virial_sum_;
+}
+
+// Returns the simulation time the window covers so far.
+double PressureMeter::GetDuration() const {
+  return time_ - start_ - std::max(0L, bin_ - bins_) * width_;
+}
+
+// Returns the window of simulation time.
+double PressureMeter::GetWindow() const {
+  return width_ * bins_;
+}
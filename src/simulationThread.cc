@@ -0,0 +1,231 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "include/simulationThread.h"
+#include "include/collisionSystem.h"
+#include "include/event.h"
+#include "include/particleStore.h"
+#include "include/snapshot.h"
+
+// Wall time of a batch of events, between two checks for commands, in
+// seconds: commands wait for it at most.
+static constexpr double kBatchSeconds {0.002};
+
+// Number of positions of the path of the particle followed: each snapshot
+// copies them all.
+static constexpr std::size_t kMaxPathPoints {4096};
+
+// Starts a thread simulating the specified system, paused, with the
+// specified number of redraw events per second. Particle tracked may be
+// followed from collision to collision.
+SimulationThread::SimulationThread(CollisionSystem* system,
+    double redraws_per_second, int tracked) :
+    system_ {system},
+    tracked_ {tracked},
+    redraw_period_ {std::chrono::duration_cast<
+        std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / redraws_per_second))},
+    following_ {false},
+    path_start_ {0},
+    signaled_ {true},
+    paused_ {true}, stopping_ {false} {
+  // Front ends have a snapshot to draw from the start
+  Publish();
+  thread_ = std::thread(&SimulationThread::Work, this);
+}
+
+// Stops the thread.
+SimulationThread::~SimulationThread() {
+  Stop();
+}
+
+// Queues the specified command.
+void SimulationThread::Send(const Command& command) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands_.push_back(command);
+    signaled_ = true;
+  }
+  changed_.notify_one();
+}
+
+// Pauses or resumes the simulation.
+void SimulationThread::SetPaused(bool paused) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    paused_ = paused;
+    signaled_ = true;
+  }
+  changed_.notify_one();
+}
+
+// Starts or stops following the tracked particle. Following starts a new
+// path.
+void SimulationThread::FollowPath(bool follow) {
+  Send([this, follow](CollisionSystem*) {
+    following_ = follow;
+    path_x_.clear();
+    path_y_.clear();
+    path_start_ = 0;
+  });
+}
+
+// Forgets the positions of the particle followed so far.
+void SimulationThread::ClearPath() {
+  Send([this](CollisionSystem*) {
+    path_x_.clear();
+    path_y_.clear();
+    path_start_ = 0;
+  });
+}
+
+// Returns the latest snapshot published, which stays valid until the next
+// call.
+const Snapshot& SimulationThread::GetLatest() {
+  return snapshots_.GetLatest();
+}
+
+// Stops and joins the thread.
+void SimulationThread::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    signaled_ = true;
+  }
+  changed_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+// Simulates the system until the thread stops, in batches of events taking
+// about kBatchSeconds each: the commands and the clock are only checked
+// between batches, and at redraw events. Batches grow or shrink to the
+// budget as the events get cheaper or costlier.
+void SimulationThread::Work() {
+  auto next_redraw {std::chrono::steady_clock::now()};
+  long batch {1};
+  for (;;) {
+    if (signaled_.load(std::memory_order_acquire) && !RunCommands()) {
+      return;
+    }
+
+    // Waits for the wall time of the next redraw, waking up for commands
+    auto now {std::chrono::steady_clock::now()};
+    if (next_redraw > now) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      changed_.wait_until(lock, next_redraw, [this] {
+        return signaled_.load(std::memory_order_relaxed);
+      });
+      continue;
+    }
+
+    // Events up to the batch size, or up to a redraw event that comes early
+    long events {0};
+    bool early {false};
+    while (events < batch && !early) {
+      Event event {system_->Step()};
+      events++;
+      if (following_ && (event.GetParticleA() == tracked_
+          || event.GetParticleB() == tracked_)) {
+        AddPathPoint();
+      }
+      if (event.GetType() == Event::Type::kRedraw) {
+        Publish();
+
+        // Never catches up once behind
+        next_redraw += redraw_period_;
+        auto published {std::chrono::steady_clock::now()};
+        early = next_redraw > published;
+        if (!early) {
+          next_redraw = published;
+        }
+      }
+    }
+
+    // Sizes the next batch from a whole one: twice as large at most
+    if (events == batch) {
+      std::chrono::duration<double> elapsed {
+          std::chrono::steady_clock::now() - now};
+      batch = elapsed.count() > 0.0
+          ? std::max(1L, std::min(2 * batch,
+              static_cast<long>(batch * kBatchSeconds / elapsed.count())))
+          : 2 * batch;
+    }
+  }
+}
+
+// Runs the commands queued, and returns false if the thread stops. Sleeps
+// while the simulation is paused, running the commands as they come.
+bool SimulationThread::RunCommands() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    bool ran {false};
+    while (!commands_.empty()) {
+      Command command {std::move(commands_.front())};
+      commands_.pop_front();
+      lock.unlock();
+      command(system_);
+      ran = true;
+      lock.lock();
+    }
+    if (stopping_) {
+      return false;
+    }
+    if (!paused_) {
+      break;
+    }
+
+    // No redraw event while paused: the changes are published at once
+    if (ran) {
+      lock.unlock();
+      Publish();
+      lock.lock();
+      continue;
+    }
+    changed_.wait(lock, [this] {
+      return stopping_ || !paused_ || !commands_.empty();
+    });
+  }
+  signaled_ = false;
+  return true;
+}
+
+// Adds the position of the tracked particle to its path, over the oldest
+// one once the path is full.
+void SimulationThread::AddPathPoint() {
+  const ParticleStore& particles {system_->GetParticles()};
+  if (path_x_.size() < kMaxPathPoints) {
+    path_x_.push_back(particles.GetRx(tracked_));
+    path_y_.push_back(particles.GetRy(tracked_));
+    return;
+  }
+  path_x_[path_start_] = particles.GetRx(tracked_);
+  path_y_[path_start_] = particles.GetRy(tracked_);
+  path_start_ = (path_start_ + 1) % kMaxPathPoints;
+}
+
+// Takes a snapshot of the system and publishes it. The path is copied from
+// its oldest position on.
+void SimulationThread::Publish() {
+  system_->Synchronize();
+  Snapshot* snapshot {snapshots_.GetBack()};
+  snapshot->Take(*system_);
+  snapshot->path_x.assign(path_x_.begin() + path_start_, path_x_.end());
+  snapshot->path_x.insert(snapshot->path_x.end(), path_x_.begin(),
+      path_x_.begin() + path_start_);
+  snapshot->path_y.assign(path_y_.begin() + path_start_, path_y_.end());
+  snapshot->path_y.insert(snapshot->path_y.end(), path_y_.begin(),
+      path_y_.begin() + path_start_);
+  snapshots_.Publish();
+}
@@ -0,0 +1,89 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "include/snapshot.h"
+#include "include/collisionSystem.h"
+#include "include/particleStore.h"
+#include "include/speedHistogram.h"
+
+// Flag of the middle snapshot of a buffer, published since the reader last
+// took it.
+static constexpr int kFresh {4};
+
+// Initializes a snapshot of a system with no particles.
+Snapshot::Snapshot() :
+    time {0.0}, wall_size {0.0}, wall_speed {0.0},
+    area {0.0}, average_kinetic_energy {0.0},
+    pressure {0.0}, wall_pressure {0.0},
+    collisions {0},
+    queue_size {0},
+    bucket_size {0.0} {}
+
+// Copies the state of the specified system, as of the last update of its
+// particles, reusing the memory of the arrays.
+void Snapshot::Take(const CollisionSystem& system) {
+  const ParticleStore& particles {system.GetParticles()};
+  time = system.GetTime();
+  wall_size = system.GetWallSize();
+  wall_speed = system.GetWallSpeed();
+
+  rx.clear();
+  ry.clear();
+  radius.clear();
+  speed.clear();
+  for (unsigned int i {0}; i < particles.Size(); ++i) {
+    if (!particles.IsAlive(i)) {
+      continue;
+    }
+    rx.push_back(particles.GetRx(i));
+    ry.push_back(particles.GetRy(i));
+    radius.push_back(particles.GetRadius(i));
+    speed.push_back(particles.GetSpeed(i));
+  }
+
+  area = particles.GetArea();
+  average_kinetic_energy = system.GetAverageKineticEnergy();
+  pressure = system.GetPressure();
+  wall_pressure = system.GetWallPressure();
+  collisions = system.GetCollisions();
+  queue_size = system.GetQueueSize();
+  stats = system.GetStats();
+
+  speed_counts.clear();
+  const SpeedHistogram* histogram {particles.GetSpeedHistogram()};
+  if (histogram != nullptr) {
+    bucket_size = histogram->GetBucketSize();
+    for (int k {0}; k < histogram->GetBuckets(); ++k) {
+      speed_counts.push_back(histogram->GetCount(k));
+    }
+  }
+}
+
+// Initializes a buffer of empty snapshots.
+SnapshotBuffer::SnapshotBuffer() :
+    back_ {0}, front_ {2},
+    middle_ {1} {}
+
+// Returns the snapshot to fill, on the writer thread.
+Snapshot* SnapshotBuffer::GetBack() {
+  return &snapshots_[back_];
+}
+
+// Publishes the snapshot filled, on the writer thread: it becomes the middle
+// one, and the writer fills the previous middle one next.
+void SnapshotBuffer::Publish() {
+  back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel)
+      & ~kFresh;
+}
+
+// Returns the latest snapshot published, on the reader thread: the middle
+// one if it is fresh, the front one otherwise.
+const Snapshot& SnapshotBuffer::GetLatest() {
+  if (middle_.load(std::memory_order_relaxed) & kFresh) {
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~kFresh;
+  }
+  return snapshots_[front_];
+}
@@ -0,0 +1,58 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "include/speedHistogram.h"
+
+// Initializes an empty histogram with buckets of the specified size.
+SpeedHistogram::SpeedHistogram(double bucket_size) :
+    bucket_size_ {bucket_size},
+    buckets_ {0} {}
+
+// Counts a particle of the specified speed.
+void SpeedHistogram::Add(double speed) {
+  int k {GetBucket(speed)};
+  if (k >= static_cast<int>(counts_.size())) {
+    counts_.resize(k + 1, 0);
+  }
+  counts_[k]++;
+  buckets_ = std::max(buckets_, k + 1);
+}
+
+// Stops counting a particle of the specified speed, as it was added. The
+// last bucket holding particles is looked for from the former one down,
+// which costs O(1) on average as speeds spread over many buckets.
+void SpeedHistogram::Remove(double speed) {
+  counts_[GetBucket(speed)]--;
+  while (buckets_ > 0 && counts_[buckets_ - 1] == 0) {
+    buckets_--;
+  }
+}
+
+// Removes every particle.
+void SpeedHistogram::Clear() {
+  std::fill(counts_.begin(), counts_.end(), 0);
+  buckets_ = 0;
+}
+
+// Returns the size of the buckets.
+double SpeedHistogram::GetBucketSize() const {
+  return bucket_size_;
+}
+
+// Returns the number of buckets up to the last one holding particles.
+int SpeedHistogram::GetBuckets() const {
+  return buckets_;
+}
+
+// Returns the number of particles of bucket k.
+int SpeedHistogram::GetCount(int k) const {
+  return counts_[k];
+}
+
+// Returns the bucket of the specified speed.
+int SpeedHistogram::GetBucket(double speed) const {
+  return static_cast<int>(std::floor(speed / bucket_size_));
+}
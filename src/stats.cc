@@ -0,0 +1,49 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cstddef>
+#include <cstdio>
+
+#include "include/stats.h"
+#include "include/event.h"
+
+// Names of the event types in JSON, indexed by Event::Type.
+static const char* const kEventNames[kEventTypes] {"particle_particle",
+    "vertical_wall", "horizontal_wall", "cell_crossing", "redraw"};
+
+// Initializes every counter to 0.
+Stats::Stats() :
+    events {},
+    invalid_events {0},
+    queue_high_water {0},
+    overlaps {0},
+    predict_seconds {0.0}, advance_seconds {0.0} {}
+
+// Returns the number of events processed of the specified type.
+long Stats::GetEvents(Event::Type type) const {
+  return events[static_cast<int>(type)];
+}
+
+// Returns the number of events processed, of every type.
+long Stats::GetEvents() const {
+  long total {0};
+  for (long count : events) {
+    total += count;
+  }
+  return total;
+}
+
+// Writes the specified stats, at the specified simulation clock time, as one
+// line of JSON.
+void WriteStats(FILE* file, double time, const Stats& stats) {
+  fprintf(file, "{\"time\": %.6f, \"events\": {", time);
+  for (int k {0}; k < kEventTypes; ++k) {
+    fprintf(file, "%s\"%s\": %ld", k > 0 ? ", " : "", kEventNames[k],
+        stats.events[k]);
+  }
+  fprintf(file, "}, \"invalid_events\": %ld, \"queue_high_water\": %zu, "
+      "\"overlaps\": %ld, \"predict_seconds\": %.6f, "
+      "\"advance_seconds\": %.6f}\n",
+      stats.invalid_events, stats.queue_high_water, stats.overlaps,
+      stats.predict_seconds, stats.advance_seconds);
+  fflush(file);
+}
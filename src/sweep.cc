@@ -0,0 +1,283 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "include/main.h"
+#include "include/sweep.h"
+#include "include/lattice.h"
+#include "include/collisionSystem.h"
+#include "include/particleStore.h"
+#include "include/eventQueue.h"
+
+// Boltzmann constant (J/K), as the viewer uses it.
+static constexpr double kBoltzmannConstant {1.3806503e-23};
+
+// A line of results: the name and value of each column.
+typedef std::vector<std::pair<const char*, double>> Row;
+
+// Parses a number, and returns false if the text is not a number.
+static bool ParseValue(const std::string& text, double* value) {
+  std::istringstream ss {text};
+  if (!(ss >> *value) || !(ss >> std::ws).eof()) {
+    std::cerr << "Invalid number " << text << '\n';
+    return false;
+  }
+  return true;
+}
+
+// Parses a list of values: either comma separated values, or start:stop:step
+// for the values from start to stop included.
+bool ParseValues(const std::string& list, std::vector<double>* values) {
+  values->clear();
+
+  std::size_t colon {list.find(':')};
+  if (colon != std::string::npos) {
+    std::size_t second {list.find(':', colon + 1)};
+    if (second == std::string::npos) {
+      std::cerr << "Invalid range " << list << '\n';
+      return false;
+    }
+    double start {0.0}, stop {0.0}, step {0.0};
+    if (!ParseValue(list.substr(0, colon), &start)
+        || !ParseValue(list.substr(colon + 1, second - colon - 1), &stop)
+        || !ParseValue(list.substr(second + 1), &step)) {
+      return false;
+    }
+    if (step <= 0 || stop < start) {
+      std::cerr << "Invalid range " << list << '\n';
+      return false;
+    }
+
+    // Values computed from the start, not accumulated, so that the stop
+    // value is not missed by a rounding error
+    long count {static_cast<long>(std::floor((stop - start) / step + 1e-9))};
+    for (long k {0}; k <= count; ++k) {
+      values->push_back(start + k * step);
+    }
+    return true;
+  }
+
+  std::size_t begin {0};
+  for (;;) {
+    std::size_t comma {list.find(',', begin)};
+    double value {0.0};
+    if (!ParseValue(list.substr(begin, comma - begin), &value)) {
+      return false;
+    }
+    values->push_back(value);
+    if (comma == std::string::npos) {
+      return true;
+    }
+    begin = comma + 1;
+  }
+}
+
+// Returns every combination of the specified values, with seeds seeds from
+// first_seed on each.
+std::vector<SweepPoint> MakeSweep(const std::vector<double>& radii,
+    const std::vector<double>& spacings, const std::vector<double>& frictions,
+    unsigned int first_seed, int seeds) {
+  std::vector<SweepPoint> points;
+  for (double radius : radii) {
+    for (double spacing : spacings) {
+      for (double friction : frictions) {
+        for (int k {0}; k < seeds; ++k) {
+          points.push_back(SweepPoint {radius, spacing, friction,
+              first_seed + k});
+        }
+      }
+    }
+  }
+  return points;
+}
+
+// Runs the specified point up to the specified time on the calling thread,
+// and returns its observables. The pressures are measured over the whole
+// run.
+SweepResult RunSweepPoint(const SweepPoint& point, double duration,
+    EventQueue::Type scheduler) {
+  auto start {std::chrono::steady_clock::now()};
+
+  CollisionSystem system {MakeSquareLattice(point.radius, point.spacing,
+      point.seed), point.friction, scheduler, 1};
+  const ParticleStore& particles = system.GetParticles();
+  system.SetPressureWindow(duration);
+  system.RunUntil(duration);
+
+  std::chrono::duration<double> elapsed {
+      std::chrono::steady_clock::now() - start};
+
+  SweepResult result;
+  result.point = point;
+  result.particles = particles.Count();
+
+  double wall_size {system.GetWallSize()};
+  result.packing_fraction = particles.GetArea() / (wall_size * wall_size);
+
+  result.time = system.GetTime();
+  result.collisions = system.GetCollisions();
+  result.collision_rate = 0.0;
+  if (result.particles > 0 && duration > 0) {
+    result.collision_rate = result.collisions / (result.particles * duration);
+  }
+  result.pressure = system.GetWallPressure();
+  result.virial_pressure = system.GetPressure();
+  result.temperature = (2.0 / 3.0) * system.GetAverageKineticEnergy()
+      / kBoltzmannConstant;
+  result.seconds = elapsed.count();
+  return result;
+}
+
+// Returns the line of results of one run.
+static Row MakeRow(const SweepResult& result) {
+  return Row {
+    {"radius", result.point.radius},
+    {"spacing", result.point.spacing},
+    {"friction", result.point.friction},
+    {"seed", result.point.seed},
+    {"particles", result.particles},
+    {"packing_fraction", result.packing_fraction},
+    {"time", result.time},
+    {"collisions", result.collisions},
+    {"collision_rate", result.collision_rate},
+    {"temperature", result.temperature},
+    {"pressure", result.pressure},
+    {"virial_pressure", result.virial_pressure},
+    {"seconds", result.seconds}
+  };
+}
+
+// Returns the mean and the standard deviation of the values.
+static std::pair<double, double> Average(const std::vector<double>& values) {
+  double mean {0.0};
+  for (double value : values) {
+    mean += value;
+  }
+  mean /= values.size();
+
+  double variance {0.0};
+  for (double value : values) {
+    variance += pow(value - mean, 2);
+  }
+  if (values.size() > 1) {
+    variance /= values.size() - 1;
+  }
+  return std::make_pair(mean, std::sqrt(variance));
+}
+
+// Returns the line of results of the runs of one set of parameters,
+// averaged over the seeds.
+static Row MakeAverageRow(const std::vector<SweepResult>& runs) {
+  const SweepResult& first = runs[0];
+  std::vector<double> collisions, rates, temperatures, pressures;
+  std::vector<double> virial_pressures;
+  double seconds {0.0};
+  for (const auto& result : runs) {
+    collisions.push_back(result.collisions);
+    rates.push_back(result.collision_rate);
+    temperatures.push_back(result.temperature);
+    pressures.push_back(result.pressure);
+    virial_pressures.push_back(result.virial_pressure);
+    seconds += result.seconds;
+  }
+
+  auto rate = Average(rates);
+  auto temperature = Average(temperatures);
+  auto pressure = Average(pressures);
+  auto virial_pressure = Average(virial_pressures);
+  return Row {
+    {"radius", first.point.radius},
+    {"spacing", first.point.spacing},
+    {"friction", first.point.friction},
+    {"seeds", collisions.size()},
+    {"particles", first.particles},
+    {"packing_fraction", first.packing_fraction},
+    {"time", first.time},
+    {"collisions", Average(collisions).first},
+    {"collision_rate", rate.first},
+    {"collision_rate_std", rate.second},
+    {"temperature", temperature.first},
+    {"temperature_std", temperature.second},
+    {"pressure", pressure.first},
+    {"pressure_std", pressure.second},
+    {"virial_pressure", virial_pressure.first},
+    {"virial_pressure_std", virial_pressure.second},
+    {"seconds", seconds}
+  };
+}
+
+// Starts writing to the specified file, in JSON if json is true and in CSV
+// otherwise, for a sweep of seeds runs per set of parameters.
+SweepWriter::SweepWriter(FILE* file, bool json, bool average, int seeds) :
+    file_ {file},
+    json_ {json}, average_ {average},
+    seeds_ {seeds},
+    rows_ {0} {
+  if (json_) {
+    fprintf(file_, "[");
+    fflush(file_);
+  }
+}
+
+// Writes the result of run k of the sweep, or holds it until the other seeds
+// of its parameters are done. The runs of a set of parameters follow each
+// other in the sweep.
+void SweepWriter::Add(std::size_t k, const SweepResult& result) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!average_) {
+    Write(MakeRow(result));
+    return;
+  }
+
+  std::size_t set {k / seeds_};
+  std::vector<SweepResult>& runs = pending_[set];
+  runs.push_back(result);
+  if (runs.size() == static_cast<std::size_t>(seeds_)) {
+    Write(MakeAverageRow(runs));
+    pending_.erase(set);
+  }
+}
+
+// Ends the file, and returns false if it could not be written.
+bool SweepWriter::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (json_) {
+    fprintf(file_, "%s]\n", rows_ > 0 ? "\n" : "");
+  }
+  return fflush(file_) == 0 && !ferror(file_);
+}
+
+// Writes a line of results, after the names of the columns for the first
+// CSV line, and flushes it.
+void SweepWriter::Write(const Row& row) {
+  if (json_) {
+    fprintf(file_, "%s\n  {", rows_ > 0 ? "," : "");
+    for (std::size_t k {0}; k < row.size(); ++k) {
+      fprintf(file_, "%s\"%s\": %.10g", k > 0 ? ", " : "", row[k].first,
+          row[k].second);
+    }
+    fprintf(file_, "}");
+  } else {
+    if (rows_ == 0) {
+      for (std::size_t k {0}; k < row.size(); ++k) {
+        fprintf(file_, "%s%s", k > 0 ? "," : "", row[k].first);
+      }
+      fprintf(file_, "\n");
+    }
+    for (std::size_t k {0}; k < row.size(); ++k) {
+      fprintf(file_, "%s%.10g", k > 0 ? "," : "", row[k].second);
+    }
+    fprintf(file_, "\n");
+  }
+  fflush(file_);
+  rows_++;
+}
@@ -0,0 +1,173 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "include/threadPool.h"
+
+// Starts the specified number of threads, the calling one included. 0
+// starts one per hardware thread.
+ThreadPool::ThreadPool(int threads) :
+    job_ {nullptr},
+    generation_ {0},
+    running_ {0},
+    stop_ {false} {
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int thread {1}; thread < threads; ++thread) {
+    workers_.emplace_back(&ThreadPool::Work, this, thread);
+  }
+}
+
+// Stops and joins the worker threads.
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  start_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+// Runs the iterations [0, count) of the task, split into one contiguous
+// range per thread, and returns when they are all done.
+void ThreadPool::ParallelFor(std::size_t count, const Task& task) {
+  if (workers_.empty() || count < workers_.size() + 1) {
+    if (count > 0) {
+      task(0, count, 0);
+    }
+    return;
+  }
+
+  std::size_t threads {workers_.size() + 1};
+  Run([count, &task, threads](int thread) {
+    std::size_t begin {count * thread / threads};
+    std::size_t end {count * (thread + 1) / threads};
+    if (begin < end) {
+      task(begin, end, thread);
+    }
+  });
+}
+
+// Runs the iterations [0, count) of the task one at a time, and returns when
+// they are all done. Each thread starts with a contiguous range, and steals
+// half of the iterations left to another thread once done with its own.
+void ThreadPool::ParallelForStealing(std::size_t count, const Task& task) {
+  if (workers_.empty()) {
+    for (std::size_t i {0}; i < count; ++i) {
+      task(i, i + 1, 0);
+    }
+    return;
+  }
+
+  // Iterations left to each thread, taken from the front by the thread and
+  // from the back by thieves
+  struct Range {
+    std::mutex mutex;
+    std::size_t begin, end;
+  };
+  std::size_t threads {workers_.size() + 1};
+  std::vector<Range> ranges(threads);
+  for (std::size_t thread {0}; thread < threads; ++thread) {
+    ranges[thread].begin = count * thread / threads;
+    ranges[thread].end = count * (thread + 1) / threads;
+  }
+
+  Run([&task, &ranges, threads](int thread) {
+    Range& own = ranges[thread];
+    for (;;) {
+      std::size_t i {0};
+      bool found {false};
+      {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.begin < own.end) {
+          i = own.begin++;
+          found = true;
+        }
+      }
+      if (found) {
+        task(i, i + 1, thread);
+        continue;
+      }
+
+      // Steal from the next threads, never holding two locks at once
+      bool stolen {false};
+      for (std::size_t k {1}; k < threads && !stolen; ++k) {
+        Range& victim = ranges[(thread + k) % threads];
+        std::size_t begin {0}, end {0};
+        {
+          std::lock_guard<std::mutex> lock(victim.mutex);
+          if (victim.begin < victim.end) {
+            end = victim.end;
+            begin = victim.end - (victim.end - victim.begin + 1) / 2;
+            victim.end = begin;
+            stolen = true;
+          }
+        }
+        if (stolen) {
+          std::lock_guard<std::mutex> lock(own.mutex);
+          own.begin = begin;
+          own.end = end;
+        }
+      }
+      if (!stolen) {
+        return;
+      }
+    }
+  });
+}
+
+// Returns the number of threads, the calling one included.
+int ThreadPool::GetThreads() const {
+  return workers_.size() + 1;
+}
+
+// Runs the job on every thread, the calling one included, and returns when
+// they are all done.
+void ThreadPool::Run(const Job& job) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_ = &job;
+    running_ = workers_.size();
+    ++generation_;
+  }
+  start_.notify_all();
+
+  job(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return running_ == 0; });
+  job_ = nullptr;
+}
+
+// Waits for loops and runs the job of the specified worker thread.
+void ThreadPool::Work(int thread) {
+  long generation {0};
+  for (;;) {
+    const Job* job {nullptr};
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [this, generation] {
+        return stop_ || generation_ != generation;
+      });
+      if (stop_) {
+        return;
+      }
+      generation = generation_;
+      job = job_;
+    }
+
+    (*job)(thread);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --running_;
+    }
+    done_.notify_one();
+  }
+}
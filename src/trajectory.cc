@@ -0,0 +1,343 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "include/trajectory.h"
+#include "include/particleStore.h"
+
+// Number of frames queued at most: frames beyond are dropped rather than
+// stalling the simulation, or taking up all the memory.
+static constexpr std::size_t kMaxPendingFrames {16};
+
+// Returns the size of the indices of count particles, padded to 8 bytes.
+static std::size_t IdsSize(std::size_t count) {
+  return (count * sizeof(int32_t) + 7) / 8 * 8;
+}
+
+// Returns the size of a frame of count particles, its header included.
+static std::size_t FrameSize(std::size_t count) {
+  return sizeof(TrajectoryFrameHeader) + IdsSize(count)
+      + 4 * count * sizeof(double);
+}
+
+// Returns whether a whole frame lies at the specified offset of the
+// specified data, of the specified size, aligned and of a consistent size.
+static bool IsFrame(const char* data, std::size_t size, uint64_t offset) {
+  if (offset % 8 != 0 || offset < sizeof(TrajectoryHeader)
+      || offset > size || size - offset < sizeof(TrajectoryFrameHeader)) {
+    return false;
+  }
+  const TrajectoryFrameHeader* frame {
+      reinterpret_cast<const TrajectoryFrameHeader*>(data + offset)};
+
+  // Counts too large for the file would overflow the size of the frame
+  return frame->count <= size / (4 * sizeof(double))
+      && frame->size == FrameSize(frame->count)
+      && frame->size <= size - offset;
+}
+
+// Initializes a writer with no file.
+TrajectoryWriter::TrajectoryWriter() :
+    file_ {nullptr},
+    offset_ {0},
+    frames_ {0}, dropped_ {0},
+    failed_ {false},
+    closing_ {false} {}
+
+// Closes the file.
+TrajectoryWriter::~TrajectoryWriter() {
+  Close();
+}
+
+// Creates the specified file, for a simulation box of the specified size,
+// and starts the writer thread.
+bool TrajectoryWriter::Open(const std::string& path, double wall_size) {
+  Close();
+
+  file_ = fopen(path.c_str(), "wb");
+  if (file_ == nullptr) {
+    return false;
+  }
+
+  TrajectoryHeader header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kTrajectoryMagic, sizeof(header.magic));
+  header.version = kTrajectoryVersion;
+  header.byte_order = kTrajectoryByteOrder;
+  header.wall_size = wall_size;
+  if (fwrite(&header, sizeof(header), 1, file_) != 1) {
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+
+  offsets_.clear();
+  offset_ = sizeof(header);
+  frames_ = 0;
+  dropped_ = 0;
+  failed_ = false;
+  closing_ = false;
+  thread_ = std::thread(&TrajectoryWriter::Work, this);
+  return true;
+}
+
+// Queues a frame of the specified particles, as of their last update, at the
+// specified time. The frame is dropped if the writer thread is too far
+// behind.
+void TrajectoryWriter::Write(double time, const ParticleStore& particles) {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  std::vector<char> buffer;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (pending_.size() >= kMaxPendingFrames) {
+      dropped_++;
+      return;
+    }
+    if (!buffers_.empty()) {
+      buffer.swap(buffers_.back());
+      buffers_.pop_back();
+    }
+  }
+
+  std::size_t count {particles.Count()};
+  buffer.assign(FrameSize(count), 0);
+
+  TrajectoryFrameHeader header;
+  std::memset(&header, 0, sizeof(header));
+  header.time = time;
+  header.count = count;
+  header.size = buffer.size();
+  std::memcpy(buffer.data(), &header, sizeof(header));
+
+  // Arrays of the frame, filled one particle at a time
+  char* ids {buffer.data() + sizeof(header)};
+  char* values {ids + IdsSize(count)};
+  std::size_t k {0};
+  for (unsigned int i {0}; i < particles.Size(); ++i) {
+    if (!particles.IsAlive(i)) {
+      continue;
+    }
+    int32_t id {static_cast<int32_t>(i)};
+    double state[4] {particles.GetRx(i), particles.GetRy(i),
+        particles.GetVx(i), particles.GetVy(i)};
+    std::memcpy(ids + k * sizeof(id), &id, sizeof(id));
+    for (int a {0}; a < 4; ++a) {
+      std::memcpy(values + (a * count + k) * sizeof(double), &state[a],
+          sizeof(double));
+    }
+    k++;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.push_back(std::move(buffer));
+    frames_++;
+  }
+  queued_.notify_one();
+}
+
+// Writes the frames left, then the index, and closes the file. The header
+// gets the number of frames and the offset of the index last, so that a file
+// left unclosed still reads frame by frame. A file a frame failed to go to
+// is left without an index, its frames read up to the failure.
+void TrajectoryWriter::Close() {
+  if (file_ == nullptr) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  queued_.notify_one();
+  thread_.join();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!failed_) {
+    uint64_t index_offset {offset_};
+    uint64_t frames {offsets_.size()};
+    failed_ = fwrite(offsets_.data(), sizeof(uint64_t), offsets_.size(),
+            file_) != offsets_.size()
+        || fseek(file_, offsetof(TrajectoryHeader, frames), SEEK_SET) != 0
+        || fwrite(&frames, sizeof(frames), 1, file_) != 1
+        || fwrite(&index_offset, sizeof(index_offset), 1, file_) != 1;
+  }
+  failed_ = fclose(file_) != 0 || failed_;
+  file_ = nullptr;
+
+  pending_.clear();
+  buffers_.clear();
+}
+
+// Returns the number of frames queued so far.
+long TrajectoryWriter::GetFrames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_;
+}
+
+// Returns the number of frames dropped so far.
+long TrajectoryWriter::GetDroppedFrames() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+// Returns whether the file could not be written.
+bool TrajectoryWriter::HasFailed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return failed_;
+}
+
+// Writes the queued frames until the file is closed, and every frame queued
+// is written. Frames queued after a failure are skipped.
+void TrajectoryWriter::Work() {
+  for (;;) {
+    std::vector<char> buffer;
+    bool failed {false};
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queued_.wait(lock, [this] { return closing_ || !pending_.empty(); });
+      if (pending_.empty()) {
+        return;
+      }
+      buffer.swap(pending_.front());
+      pending_.pop_front();
+      failed = failed_;
+    }
+
+    if (!failed) {
+      failed = fwrite(buffer.data(), 1, buffer.size(), file_)
+          != buffer.size();
+      if (!failed) {
+        offsets_.push_back(offset_);
+        offset_ += buffer.size();
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    failed_ = failed_ || failed;
+    buffers_.push_back(std::move(buffer));
+  }
+}
+
+// Initializes a reader with no file.
+TrajectoryReader::TrajectoryReader() :
+    data_ {nullptr},
+    size_ {0} {}
+
+// Unmaps the file.
+TrajectoryReader::~TrajectoryReader() {
+  Close();
+}
+
+// Maps the specified file, and returns false if it is not a trajectory file
+// this version reads, or if its index points outside of the file. Files left
+// unclosed have no index: their frames are found one after the other.
+bool TrajectoryReader::Open(const std::string& path) {
+  Close();
+
+  int fd {open(path.c_str(), O_RDONLY)};
+  if (fd < 0) {
+    return false;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0
+      || static_cast<std::size_t>(status.st_size) < sizeof(TrajectoryHeader)) {
+    close(fd);
+    return false;
+  }
+  void* data {mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+  data_ = static_cast<const char*>(data);
+  size_ = status.st_size;
+
+  const TrajectoryHeader* header {
+      reinterpret_cast<const TrajectoryHeader*>(data_)};
+  if (std::memcmp(header->magic, kTrajectoryMagic, sizeof(header->magic)) != 0
+      || header->version != kTrajectoryVersion
+      || header->byte_order != kTrajectoryByteOrder) {
+    Close();
+    return false;
+  }
+
+  if (header->index_offset != 0 && header->index_offset % 8 == 0
+      && header->index_offset <= size_
+      && header->frames <= (size_ - header->index_offset) / sizeof(uint64_t)) {
+    const uint64_t* index {
+        reinterpret_cast<const uint64_t*>(data_ + header->index_offset)};
+    offsets_.assign(index, index + header->frames);
+    for (uint64_t offset : offsets_) {
+      if (!IsFrame(data_, size_, offset)) {
+        Close();
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint64_t offset {sizeof(TrajectoryHeader)};
+  while (IsFrame(data_, size_, offset)) {
+    offsets_.push_back(offset);
+    offset += reinterpret_cast<const TrajectoryFrameHeader*>(
+        data_ + offset)->size;
+  }
+  return true;
+}
+
+// Unmaps the file.
+void TrajectoryReader::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+  offsets_.clear();
+}
+
+// Returns the size of the simulation box.
+double TrajectoryReader::GetWallSize() const {
+  return reinterpret_cast<const TrajectoryHeader*>(data_)->wall_size;
+}
+
+// Returns the number of frames.
+std::size_t TrajectoryReader::GetFrames() const {
+  return offsets_.size();
+}
+
+// Returns frame k.
+TrajectoryReader::Frame TrajectoryReader::GetFrame(std::size_t k) const {
+  const char* data {data_ + offsets_[k]};
+  const TrajectoryFrameHeader* header {
+      reinterpret_cast<const TrajectoryFrameHeader*>(data)};
+
+  Frame frame;
+  frame.time = header->time;
+  frame.count = header->count;
+  frame.ids = reinterpret_cast<const int32_t*>(data + sizeof(*header));
+  const double* values {reinterpret_cast<const double*>(
+      data + sizeof(*header) + IdsSize(frame.count))};
+  frame.rx = values;
+  frame.ry = values + frame.count;
+  frame.vx = values + 2 * frame.count;
+  frame.vy = values + 3 * frame.count;
+  return frame;
+}
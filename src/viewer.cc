@@ -0,0 +1,631 @@
+// Copyright 2018, Samuel Diebolt <samuel.diebolt@espci.fr>
+
+#include <cstdio>
+#include <sstream>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+
+#include "include/main.h"
+#include "include/viewer.h"
+#include "include/collisionSystem.h"
+#include "include/particle.h"
+#include "include/particleStore.h"
+#include "include/overlaps.h"
+#include "include/event.h"
+#include "include/hsv2rgb.h"
+#include "include/stats.h"
+#include "include/isosurface.h"
+#include "include/simulationThread.h"
+#include "include/snapshot.h"
+
+// Size of the buckets of the velocity histogram.
+static constexpr double kBucketSize {0.02};
+
+// Number of colors of the particles: one per degree of hue, which wraps
+// around.
+static constexpr int kHues {360};
+
+// Hue of the particles per unit of speed.
+static constexpr double kHuePerSpeed {100.0};
+
+// Size of the texture of the disks, in pixels.
+static constexpr int kDiskTextureSize {64};
+
+// Redraw events per second of wall time: the simulation runs at this pace
+// when it keeps up.
+static constexpr double kRedrawsPerSecond {60.0};
+
+// Sets the 4 vertices of a quad showing the disk texture, of the specified
+// size, in the specified color.
+static void SetDisk(sf::Vertex* quad, float left, float top, float right,
+    float bottom, float size, sf::Color color) {
+  quad[0] = sf::Vertex(sf::Vector2f(left, top), color, sf::Vector2f(0, 0));
+  quad[1] = sf::Vertex(sf::Vector2f(right, top), color,
+      sf::Vector2f(size, 0));
+  quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color,
+      sf::Vector2f(size, size));
+  quad[3] = sf::Vertex(sf::Vector2f(left, bottom), color,
+      sf::Vector2f(0, size));
+}
+
+// Opens the window for the specified collision system.
+Viewer::Viewer(CollisionSystem* system) :
+    window_ {sf::VideoMode(WINDOW_SIZE, WINDOW_SIZE),
+        "Molecular Dynamics", sf::Style::Titlebar | sf::Style::Close},
+    system_ {system},
+    render_seconds_ {0.0},
+    histogram_ {sf::Quads},
+    curve_temperature_ {0.0},
+    curve_buckets_ {0},
+    curve_scale_ {0.0},
+    disks_ {sf::Quads},
+    speed_colors_(kHues) {
+  // Initialize the window
+  window_.setFramerateLimit(60);
+
+  // Colors of the particles, by hue
+  for (int hue {0}; hue < kHues; ++hue) {
+    float red {0}, green {0}, blue {0};
+    // Using HSV color space is easier to color the particles
+    HSVtoRGB(hue, 1.0, 1.0, &red, &green, &blue);
+    speed_colors_[hue] = sf::Color(red * 255, green * 255, blue * 255);
+  }
+
+  // White disk, its edge smoothed over a pixel, tinted by the colors of the
+  // quads it is drawn on
+  std::vector<sf::Uint8> pixels(4 * kDiskTextureSize * kDiskTextureSize, 255);
+  double center {kDiskTextureSize / 2.0};
+  for (int y {0}; y < kDiskTextureSize; ++y) {
+    for (int x {0}; x < kDiskTextureSize; ++x) {
+      double distance {std::hypot(x + 0.5 - center, y + 0.5 - center)};
+      double coverage {std::min(std::max(center - distance, 0.0), 1.0)};
+      pixels[4 * (y * kDiskTextureSize + x) + 3] = coverage * 255;
+    }
+  }
+  disk_texture_.create(kDiskTextureSize, kDiskTextureSize);
+  disk_texture_.update(pixels.data());
+  disk_texture_.setSmooth(true);
+
+  // The particles keep the histogram up to date from now on
+  system_->TrackSpeeds(kBucketSize);
+}
+
+// Redraws all particles of the specified snapshot.
+void Viewer::Redraw(const Snapshot& snapshot, bool display_isosurface) {
+  if (display_isosurface == true && window_.isOpen()) {
+    // The renderer and its texture are kept from frame to frame
+    if (!isosurface_) {
+      int size {static_cast<int>(BOX_SIZE)};
+      double corner {(WINDOW_SIZE - BOX_SIZE) / 2};
+      isosurface_.reset(new IsosurfaceRenderer(size, size, corner, corner));
+      isosurface_texture_.create(size, size);
+      isosurface_sprite_.setTexture(isosurface_texture_);
+      isosurface_sprite_.setPosition(corner, corner);
+    }
+
+    isosurface_texture_.update(isosurface_->Render(snapshot).data());
+    window_.draw(isosurface_sprite_);
+  } else {
+    // One textured quad per particle, all drawn at once
+    disks_.resize(4 * snapshot.rx.size());
+    float size {static_cast<float>(kDiskTextureSize)};
+    for (std::size_t i {0}; i < snapshot.rx.size(); ++i) {
+      // Change the particle's color based on its speed
+      int hue {static_cast<int>(snapshot.speed[i] * kHuePerSpeed) % kHues};
+      sf::Color color {speed_colors_[hue]};
+
+      float x {static_cast<float>(snapshot.rx[i])};
+      float y {static_cast<float>(snapshot.ry[i])};
+      float radius {static_cast<float>(snapshot.radius[i])};
+      SetDisk(&disks_[4 * i], x - radius, y - radius, x + radius, y + radius,
+          size, color);
+    }
+    window_.draw(disks_, &disk_texture_);
+  }
+}
+
+// Pauses the simulation until the specified key is released, sleeping
+// until each window event.
+void Viewer::Pause(sf::Keyboard::Key pause_key) {
+  if (simulation_) {
+    simulation_->SetPaused(true);
+  }
+
+  bool pause {true};
+  sf::Event event;
+  while (pause == true && window_.waitEvent(event)) {
+    switch (event.type) {
+      case sf::Event::Closed:
+        pause = false;
+        window_.close();
+        break;
+      case sf::Event::KeyPressed:
+        if (event.key.code == sf::Keyboard::Escape) {
+          pause = false;
+          window_.close();
+        }
+        break;
+      case sf::Event::KeyReleased:
+        if (event.type == sf::Event::KeyReleased
+            && event.key.code == pause_key) {
+          pause = false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  if (simulation_) {
+    simulation_->SetPaused(false);
+  }
+}
+
+void Viewer::DrawText(const sf::Font& font, const std::string& str,
+    int character_size, sf::Color color, int x, int y) {
+  sf::Text text;
+  text.setFont(font);
+  text.setString(str);
+  text.setCharacterSize(character_size);
+  text.setFillColor(color);
+  text.setPosition(x, y);
+  window_.draw(text);
+}
+
+// Displays helper text.
+void Viewer::DisplayHelp(const sf::Font& font) {
+  window_.clear(sf::Color::Black);
+
+  DrawText(font,
+      "Press A to add a new particle at a random position.", 20,
+      sf::Color::White, 0, 0);
+
+  DrawText(font,
+      "Press B to display/hide brownian motion.", 20,
+      sf::Color::White, 0, 30);
+
+  DrawText(font,
+      "Press C to clear brownian path.", 20,
+      sf::Color::White, 0, 60);
+
+  DrawText(font,
+      "Press H to display/hide the help.", 20,
+      sf::Color::White, 0, 90);
+
+  DrawText(font,
+      "Press I to visualise isosurface.", 20,
+      sf::Color::White, 0, 120);
+
+  DrawText(font,
+      "Press P to display/hide the particles.", 20,
+      sf::Color::White, 0, 150);
+
+  DrawText(font,
+      "Press O to clear overlapped particles.", 20,
+      sf::Color::White, 0, 180);
+
+  DrawText(font,
+      "Press S to display/hide the simulation.", 20,
+      sf::Color::White, 0, 210);
+
+  DrawText(font,
+      "Press Space to pause/unpause or start the simulation.", 20,
+      sf::Color::White, 0, 240);
+
+  DrawText(font,
+      "Press the Up and Down arrows to change the size of the simulation box.",
+      20, sf::Color::White, 0, 270);
+
+  DrawText(font,
+      "Press the Left and Right arrows to change the scale of the histogram.",
+      20, sf::Color::White, 0, 300);
+
+  DrawText(font,
+      "Press Escape to quit the simulation.", 20,
+      sf::Color::White, 0, 330);
+
+  DrawText(font,
+      "The histogram displays the real velocity distribution in red\n"
+      "and the Maxwell-Boltzmann probability density function in white.", 20,
+      sf::Color::White, 0, 450);
+
+  window_.display();
+
+  Pause(sf::Keyboard::H);
+}
+
+// Displays physical quantities (temperature, pressure, etc.) of the
+// specified snapshot, the counters of the engine and helper text.
+void Viewer::DisplayCharacteristics(const Snapshot& snapshot,
+    const sf::Font& font, double elapsed_seconds, sf::Time frameTime) {
+  double average_kinetic_energy {snapshot.average_kinetic_energy};
+  double wall_size {snapshot.wall_size};
+  double wall_speed {snapshot.wall_speed};
+
+  DrawText(font,
+      "Press H to display/hide the help.", 20,
+      sf::Color::White, 600, 90);
+
+  int fps {static_cast<int>(1 / (frameTime.asMicroseconds() * pow(10, -6)))};
+  if (fps < 0) {
+    fps = 0;
+  }
+  DrawText(font,
+      "FPS: " + std::to_string(fps), 20,
+      sf::Color::White, WINDOW_SIZE - 100, 0);
+
+  DrawText(font,
+      "Speed scale", 20,
+      sf::Color::White, WINDOW_SIZE - 200, 340);
+
+  sf::VertexArray speed_scale(sf::Lines);
+  for (auto i {0}; i < 600; i += 2) {
+    for (auto j {0}; j < 2; ++j) {
+      const sf::Color& color {speed_colors_[300 - i / 2]};
+      speed_scale.append(sf::Vertex(sf::Vector2f(WINDOW_SIZE - 160,
+          400 + i + j), color));
+      speed_scale.append(sf::Vertex(sf::Vector2f(WINDOW_SIZE - 100,
+          400 + i + j), color));
+    }
+  }
+
+  window_.draw(speed_scale);
+
+  const double boltzmann_constant {1.3806503e-23};
+
+  DrawText(font,
+      "Particles count: " + std::to_string(snapshot.rx.size()), 20,
+      sf::Color::White, 0, 0);
+
+  std::string collisions_per_second {"0"};
+  if (elapsed_seconds > 0) {
+    collisions_per_second = std::to_string(static_cast<long>(
+        snapshot.collisions / elapsed_seconds));
+  }
+  DrawText(font,
+      "Collisions per second: " + collisions_per_second, 20,
+      sf::Color::White, 0, 30);
+
+  std::ostringstream streamEnerg;
+  streamEnerg << average_kinetic_energy;
+  std::string strEnerg = streamEnerg.str();
+  DrawText(font,
+      "Av. kinetic energy: " + strEnerg + "J", 20,
+      sf::Color::White, 0, 60);
+
+  double temperature {(2.0 / 3.0)
+      * average_kinetic_energy / boltzmann_constant};
+  std::ostringstream streamTemp;
+  streamTemp << temperature;
+  std::string strTemp = streamTemp.str();
+  DrawText(font,
+      "Temperature: " + strTemp + "K", 20,
+      sf::Color::White, 0, 90);
+
+  // Measured from the collisions, over the last few redraws
+  std::ostringstream streamPress;
+  streamPress << snapshot.pressure << "N/m (walls: "
+      << snapshot.wall_pressure << "N/m)";
+  std::string strPress = streamPress.str();
+  DrawText(font,
+      "Pressure: " + strPress, 20,
+      sf::Color::White, 0, 120);
+
+  double packing_factor {snapshot.area / (wall_size * wall_size)};
+  DrawText(font,
+      "Packing factor: " + std::to_string(packing_factor * 100) + "%", 20,
+      sf::Color::White, 0, 150);
+
+  DrawText(font,
+      "Time: " + std::to_string(snapshot.time), 20,
+      sf::Color::White, 600, 0);
+
+  DrawText(font,
+      "Priority queue size: " + std::to_string(snapshot.queue_size) , 20,
+      sf::Color::White, 600, 30);
+
+  DrawText(font,
+      "Wall speed: " + std::to_string(SPEED_UNIT * wall_speed / 2) , 20,
+      sf::Color::White, 600, 60);
+
+  // Counters of the engine: where the time goes
+  const Stats& stats {snapshot.stats};
+  DrawText(font,
+      "Queue high-water mark: " + std::to_string(stats.queue_high_water), 20,
+      sf::Color::White, 600, 120);
+
+  DrawText(font,
+      "Invalid events: " + std::to_string(stats.invalid_events), 20,
+      sf::Color::White, 600, 150);
+
+  DrawText(font,
+      "Overlaps: " + std::to_string(stats.overlaps), 20,
+      sf::Color::White, 600, 180);
+
+  std::ostringstream streamTimes;
+  streamTimes.precision(3);
+  streamTimes << "Predict " << stats.predict_seconds << "s, advance "
+      << stats.advance_seconds << "s, render " << render_seconds_ << "s";
+  DrawText(font,
+      streamTimes.str(), 20,
+      sf::Color::White, 0, 180);
+}
+
+// Sets the 4 vertices of a rectangle, as a quad.
+static void SetRectangle(sf::Vertex* quad, float left, float top, float right,
+    float bottom, sf::Color color) {
+  quad[0] = sf::Vertex(sf::Vector2f(left, top), color);
+  quad[1] = sf::Vertex(sf::Vector2f(right, top), color);
+  quad[2] = sf::Vertex(sf::Vector2f(right, bottom), color);
+  quad[3] = sf::Vertex(sf::Vector2f(left, bottom), color);
+}
+
+// Sets the 4 vertices of a line from a to b, one pixel thick, as a quad.
+static void SetLine(sf::Vertex* quad, sf::Vector2f a, sf::Vector2f b,
+    sf::Color color) {
+  float dx {b.x - a.x}, dy {b.y - a.y};
+  float length {std::sqrt(dx * dx + dy * dy)};
+  sf::Vector2f normal {0, 1};
+  if (length > 0) {
+    normal = sf::Vector2f(-dy / length, dx / length);
+  }
+  quad[0] = sf::Vertex(a, color);
+  quad[1] = sf::Vertex(b, color);
+  quad[2] = sf::Vertex(sf::Vector2f(b.x + normal.x, b.y + normal.y), color);
+  quad[3] = sf::Vertex(sf::Vector2f(a.x + normal.x, a.y + normal.y), color);
+}
+
+// Display the velocity histogram of the specified snapshot. The particles
+// keep the histogram up to date: drawing it only depends on the number of
+// buckets. The bars, the axis and the Maxwell-Boltzmann curve are drawn at
+// once from a buffer reused from frame to frame.
+void Viewer::DisplayVelocityHistogram(const Snapshot& snapshot,
+    double horizontal_scale) {
+  const std::vector<int>& counts {snapshot.speed_counts};
+  double average_kinetic_energy {snapshot.average_kinetic_energy};
+
+  // Buckets up to the next whole speed
+  const double bucket_size {snapshot.bucket_size};
+  int buckets {static_cast<int>(counts.size())};
+  int max_speed {static_cast<int>(buckets * bucket_size) + 1};
+  int number_of_buckets {static_cast<int>(ceil(max_speed / bucket_size))};
+
+  int max_particles {1};
+  for (int i {0}; i < buckets; ++i) {
+    max_particles = std::max(max_particles, counts[i]);
+  }
+
+  // Maxwell-Boltzmann probability density function, computed again only
+  // when the temperature or the scale change noticeably
+  const double boltzmann_constant {1.3806503e-23};
+  double mass {MASS_UNIT};
+  double temperature {(2.0 / 3.0)
+      * average_kinetic_energy / boltzmann_constant};
+  if (std::fabs(temperature - curve_temperature_) > 1e-3 * temperature
+      || number_of_buckets != curve_buckets_
+      || horizontal_scale != curve_scale_) {
+    curve_temperature_ = temperature;
+    curve_buckets_ = number_of_buckets;
+    curve_scale_ = horizontal_scale;
+    maxwell_boltzmann_.clear();
+    for (double i {0}; i < number_of_buckets; i += 0.25) {
+      double y {pow(mass / (2 * M_PI * boltzmann_constant * temperature),
+          3 / 2) * 4 * M_PI * pow(i * bucket_size * SPEED_UNIT, 2)
+          * exp(-mass * pow(i * bucket_size * SPEED_UNIT, 2)
+          / (2 * boltzmann_constant * temperature))};
+      maxwell_boltzmann_.push_back(sf::Vector2f(
+          horizontal_scale * i * bucket_size / 2, WINDOW_SIZE - 5 - 150 * y));
+    }
+  }
+
+  // Bars, axis, and the segments of the curve
+  std::size_t segments {maxwell_boltzmann_.empty() ? 0
+      : maxwell_boltzmann_.size() - 1};
+  histogram_.resize(4 * (buckets + 1 + segments));
+  std::size_t k {0};
+  for (int i {0}; i < buckets; ++i, k += 4) {
+    float right {static_cast<float>(
+        horizontal_scale * (i + 1) * bucket_size / 2)};
+    float height {static_cast<float>(
+        counts[i] * 270 / max_particles)};
+    SetRectangle(&histogram_[k], right - 1000 * bucket_size / 4,
+        WINDOW_SIZE - 5 - height, right, WINDOW_SIZE - 5, sf::Color::Red);
+  }
+  SetRectangle(&histogram_[k], 0, WINDOW_SIZE - 5, WINDOW_SIZE, WINDOW_SIZE,
+      sf::Color::White);
+  k += 4;
+  for (std::size_t i {0}; i < segments; ++i, k += 4) {
+    SetLine(&histogram_[k], maxwell_boltzmann_[i], maxwell_boltzmann_[i + 1],
+        sf::Color::White);
+  }
+
+  window_.draw(histogram_);
+}
+
+// Simulates the system of particles on a thread of its own until the window
+// is closed, and draws the latest snapshot of the system at each frame. Keys
+// are sent over to the simulation thread as commands.
+int Viewer::Run() {
+  const ParticleStore& particles {system_->GetParticles()};
+  double radius {particles.GetRadius(0)};
+
+  // Initialize random device for random position and speed when adding new
+  // particles
+  std::mt19937 rng {std::random_device()()};
+  std::uniform_real_distribution<double> random_speed(-1, 1);
+  std::uniform_real_distribution<double> random_position(
+        (WINDOW_SIZE - BOX_SIZE) / 2 + radius,
+        (WINDOW_SIZE - BOX_SIZE) / 2 + BOX_SIZE - radius);
+
+  // Booleans for displaying isosurfaces, particles, brownian motion, etc.
+  bool display_isosurface {false};
+  bool display_particles {true};
+  bool display_brownian_path {false};
+  bool display_simulation {true};
+
+  // Histogram horizontal scale
+  double histogram_scale {1000};
+
+  // Brownian motion path, followed by the simulation thread
+  sf::VertexArray brownian_path(sf::LinesStrip);
+  int brownian_particle_index = particles.Size() / 2;
+
+  // Initialize the font
+  sf::Font source_code_pro;
+  if (!source_code_pro.loadFromFile("etc/fonts/sourcecodepro.otf")) {
+    printf("Couldn't load Source Code Pro font.\n");
+    exit(1);
+  }
+
+  // Initialize the box
+  sf::RectangleShape simulation_box;
+  simulation_box.setFillColor(sf::Color::Black);
+  simulation_box.setOutlineThickness(5);
+  simulation_box.setOutlineColor(sf::Color::White);
+
+  // The system belongs to the simulation thread from now on
+  simulation_.reset(new SimulationThread(system_, kRedrawsPerSecond,
+      brownian_particle_index));
+
+  // Initialize the timer
+  sf::Clock run_clock;
+  double elapsed_seconds {0.0};
+
+  // SFML Clock for the FPS counter
+  sf::Clock clock;
+  sf::Time frameTime {};
+
+  // Initial display before starting the simulation
+  const Snapshot* snapshot {&simulation_->GetLatest()};
+  window_.clear(sf::Color::Black);
+
+  DisplayCharacteristics(*snapshot, source_code_pro, elapsed_seconds,
+      sf::Time {});
+  Redraw(*snapshot, display_isosurface);
+
+  window_.display();
+
+  Pause(sf::Keyboard::Space);
+
+  // Main loop: one frame at a time, the frame rate limit pacing it
+  while (window_.isOpen()) {
+    sf::Event event;
+    // Process user events
+    while (window_.pollEvent(event)) {
+      switch (event.type) {
+        case sf::Event::Closed:
+          window_.close();
+          break;
+        case sf::Event::KeyPressed:
+          if (event.key.code == sf::Keyboard::Escape) {
+            window_.close();
+          }
+          break;
+        case sf::Event::KeyReleased:
+          // A: add a new particle
+          if (event.key.code == sf::Keyboard::A) {
+            double rx {random_position(rng)}, ry {random_position(rng)};
+            double vx {random_speed(rng)}, vy {random_speed(rng)};
+            simulation_->Send([=](CollisionSystem* system) {
+              system->AddParticle(Particle(system->GetTime(), rx, ry, vx, vy,
+                  radius / 2, 0.25));
+            });
+          // B: display brownian path
+          } else if (event.key.code == sf::Keyboard::B) {
+            display_brownian_path = !display_brownian_path;
+            simulation_->FollowPath(display_brownian_path);
+          // C: clear the brownian path
+          } else if (event.key.code == sf::Keyboard::C) {
+            simulation_->ClearPath();
+          // H: display helper text
+          } else if (event.key.code == sf::Keyboard::H) {
+            DisplayHelp(source_code_pro);
+          // I: display isosurfaces
+          } else if (event.key.code == sf::Keyboard::I) {
+            display_isosurface = !display_isosurface;
+          // P: display particles
+          } else if (event.key.code == sf::Keyboard::P) {
+            display_particles = !display_particles;
+          // O: delete overlapped particles
+          } else if (event.key.code == sf::Keyboard::O) {
+            simulation_->Send([](CollisionSystem* system) {
+              system->ResolveOverlaps(OverlapPolicy::kRemoveYounger);
+            });
+          // S: display the simulation
+          } else if (event.key.code == sf::Keyboard::S) {
+            display_simulation = !display_simulation;
+          // Space: pause the simulation
+          } else if (event.key.code == sf::Keyboard::Space) {
+            Pause(sf::Keyboard::Space);
+          // Down: wall speed down
+          } else if (event.key.code == sf::Keyboard::Down) {
+            simulation_->Send([](CollisionSystem* system) {
+              system->SetWallSpeed(system->GetWallSpeed() - 0.1);
+            });
+          // Up: wall speed up
+          } else if (event.key.code == sf::Keyboard::Up) {
+            simulation_->Send([](CollisionSystem* system) {
+              system->SetWallSpeed(system->GetWallSpeed() + 0.1);
+            });
+          // Right: zoom in on histogram
+          } else if (event.key.code == sf::Keyboard::Right) {
+            histogram_scale += 100;
+          // Left : zoom out on histogram
+          } else if (event.key.code == sf::Keyboard::Left) {
+            histogram_scale -= 100;
+          }
+          break;
+        default:
+          break;
+      }
+    }
+    if (!window_.isOpen()) {
+      break;
+    }
+
+    // Latest state of the system: the simulation thread never waits for
+    // the drawing
+    snapshot = &simulation_->GetLatest();
+    double wall_size {snapshot->wall_size};
+    simulation_box.setSize(sf::Vector2f(wall_size, wall_size));
+    simulation_box.setPosition((WINDOW_SIZE - wall_size) / 2,
+        (WINDOW_SIZE - wall_size) / 2);
+
+    // Drawing time, without the wait for the frame rate limit
+    sf::Clock render_clock;
+    window_.clear(sf::Color::Black);
+
+    elapsed_seconds = run_clock.getElapsedTime().asSeconds();
+    DisplayCharacteristics(*snapshot, source_code_pro, elapsed_seconds,
+        frameTime);
+
+    DisplayVelocityHistogram(*snapshot, histogram_scale);
+
+    if (display_simulation) {
+      window_.draw(simulation_box);
+
+      if (display_particles) {
+        Redraw(*snapshot, display_isosurface);
+      }
+      if (display_brownian_path) {
+        brownian_path.resize(snapshot->path_x.size());
+        for (std::size_t i {0}; i < snapshot->path_x.size(); ++i) {
+          brownian_path[i].position = sf::Vector2f(snapshot->path_x[i],
+              snapshot->path_y[i]);
+        }
+        window_.draw(brownian_path);
+      }
+    }
+
+    render_seconds_ += render_clock.getElapsedTime().asSeconds();
+    window_.display();
+
+    // FPS counter
+    frameTime = clock.restart();
+  }
+
+  simulation_.reset();
+  return 0;
+}